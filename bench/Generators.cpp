@@ -0,0 +1,150 @@
+#include "Generators.h"
+
+#include <algorithm>
+#include <set>
+
+#include "Berlekamp.h"
+
+using namespace std;
+
+namespace {
+    const int MAX_IRREDUCIBLE_DEGREE = 8;
+
+    // Balanced product tree, so large inputs are built with fast multiplication
+    Polynomial product(const vector<Polynomial>& factors, size_t from, size_t to) {
+        if (to - from == 1) {
+            return factors[from];
+        }
+        size_t mid = (from + to) / 2;
+        return product(factors, from, mid) * product(factors, mid, to);
+    }
+
+    // Counts above this are never used up by a generator and are reported as the cap
+    const ll IRREDUCIBLE_COUNT_CAP = 1LL << 40;
+
+    // Number of monic irreducibles of degree k over GF(modp), (1/k) sum_{d | k} mu(d) modp^(k/d), at most the cap
+    ll irreducible_count(int k, ll modp) {
+        auto power = [&](int e) {
+            ll x = 1;
+            for (int i = 0; i < e; i++) {
+                if (x > IRREDUCIBLE_COUNT_CAP / modp) {
+                    return IRREDUCIBLE_COUNT_CAP + 1;
+                }
+                x *= modp;
+            }
+            return x;
+        };
+        if (power(k) > IRREDUCIBLE_COUNT_CAP) {
+            return IRREDUCIBLE_COUNT_CAP;
+        }
+        ll sum = 0;
+        for (int d = 1; d <= k; d++) {
+            if (k % d != 0) {
+                continue;
+            }
+            int mu = 1;
+            int rest = d;
+            for (int q = 2; q <= rest; q++) {
+                if (rest % q == 0) {
+                    rest /= q;
+                    if (rest % q == 0) {
+                        mu = 0;
+                        break;
+                    }
+                    mu = -mu;
+                }
+            }
+            sum += mu * power(k / d);
+        }
+        return sum / k;
+    }
+}
+
+Polynomial Generators::random_monic(int degree, ll modp, mt19937_64& rng) {
+    uniform_int_distribution<ll> dist(0, modp - 1);
+    vector<ll> c(degree + 1);
+    for (auto& x : c) {
+        x = dist(rng);
+    }
+    c.back() = 1;
+    return Polynomial(c, modp);
+}
+
+Polynomial Generators::random(int degree, ll modp, uint64_t seed) {
+    mt19937_64 rng(seed);
+    return random_monic(degree, modp, rng);
+}
+
+Polynomial Generators::irreducible_product(int degree, ll modp, uint64_t seed) {
+    mt19937_64 rng(seed);
+    vector<Polynomial> factors{Polynomial::get_one(modp)};
+    set<vector<ll>> used;
+    // Distinct irreducibles used so far and in total, per degree
+    vector<ll> used_of_degree(MAX_IRREDUCIBLE_DEGREE + 1, 0);
+    vector<ll> count_of_degree(MAX_IRREDUCIBLE_DEGREE + 1, 0);
+    for (int k = 1; k <= MAX_IRREDUCIBLE_DEGREE; k++) {
+        count_of_degree[k] = irreducible_count(k, modp);
+    }
+    int remaining = degree;
+    while (remaining > 0) {
+        int k = min(remaining, 1 + (int) (rng() % MAX_IRREDUCIBLE_DEGREE));
+        Polynomial candidate = random_monic(k, modp, rng);
+        // Small candidates are cheap to test by factoring
+        auto parts = berlekamp_factor(candidate, modp);
+        if (parts.size() != 1 || parts[0].second != 1) {
+            continue;
+        }
+        if (used.insert(candidate.get_coeffs(k + 1)).second) {
+            used_of_degree[k]++;
+        } else if (used.size() < 64) {
+            // A repeat is only taken once no unused irreducible of a degree that still fits is left
+            bool exhausted = true;
+            for (int j = 1; j <= min(remaining, MAX_IRREDUCIBLE_DEGREE); j++) {
+                exhausted = exhausted && used_of_degree[j] == count_of_degree[j];
+            }
+            if (!exhausted) {
+                continue;
+            }
+        }
+        factors.push_back(candidate);
+        remaining -= k;
+    }
+    return product(factors, 0, factors.size());
+}
+
+Polynomial Generators::sparse(int degree, ll modp, uint64_t seed, int terms) {
+    mt19937_64 rng(seed);
+    uniform_int_distribution<ll> dist(1, modp - 1);
+    vector<ll> c(degree + 1, 0);
+    c[degree] = 1;
+    c[0] = dist(rng);
+    for (int i = 0; i < terms && degree > 1; i++) {
+        c[1 + rng() % (degree - 1)] = dist(rng);
+    }
+    return Polynomial(c, modp);
+}
+
+Polynomial Generators::repeated_factors(int degree, ll modp, uint64_t seed, int max_multiplicity) {
+    mt19937_64 rng(seed);
+    vector<Polynomial> factors{Polynomial::get_one(modp)};
+    int remaining = degree;
+    while (remaining > 0) {
+        int multiplicity = 1 + (int) (rng() % max_multiplicity);
+        int k = 1 + (int) (rng() % 4);
+        if (k * multiplicity > remaining) {
+            multiplicity = 1;
+            k = remaining;
+        }
+        Polynomial base = random_monic(k, modp, rng);
+        for (int i = 0; i < multiplicity; i++) {
+            factors.push_back(base);
+        }
+        remaining -= k * multiplicity;
+    }
+    return product(factors, 0, factors.size());
+}
+
+const vector<ll>& Generators::primes() {
+    static const vector<ll> values{2, 3, 37, 65537, 998244353, 1000000007, (1LL << 61) - 1};
+    return values;
+}
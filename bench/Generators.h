@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "Polynomial.h"
+
+// Reproducible benchmark inputs: every generator draws from its own std::mt19937_64 seeded with seed,
+// so the same (degree, modp, seed) gives the same polynomial on every run and machine.
+// All results are monic of exactly the requested degree.
+class Generators {
+public:
+    static Polynomial random(int degree, ll modp, std::uint64_t seed);
+
+    // Product of irreducible polynomials of degree at most 8. The factors are distinct until 64 different
+    // ones have been drawn or every irreducible of a degree up to the one still missing has been used,
+    // after that repeats are allowed, since small fields such as GF(2) have too few irreducibles of low
+    // degree for large products; the result need not be squarefree then.
+    static Polynomial irreducible_product(int degree, ll modp, std::uint64_t seed);
+
+    // x^degree plus terms random coefficients at a handful of random exponents
+    static Polynomial sparse(int degree, ll modp, std::uint64_t seed, int terms = 4);
+
+    // Product of powers of a few small random factors, multiplicities up to max_multiplicity
+    static Polynomial repeated_factors(int degree, ll modp, std::uint64_t seed, int max_multiplicity = 8);
+
+    // The primes the benchmarks sweep over, 2^61 - 1 exercises the wide field path
+    static const std::vector<ll>& primes();
+
+private:
+    static Polynomial random_monic(int degree, ll modp, std::mt19937_64& rng);
+};
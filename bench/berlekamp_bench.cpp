@@ -0,0 +1,171 @@
+#include <benchmark/benchmark.h>
+
+#include <string>
+
+#include "Berlekamp.h"
+#include "Generators.h"
+#include "Matrix.h"
+#include "Polynomial.h"
+#include "PolynomialModulus.h"
+
+// Every benchmark takes (index into Generators::primes(), degree) and uses fixed seeds,
+// so JSON from --benchmark_format=json can be compared across releases entry by entry.
+
+namespace {
+    const std::uint64_t SEED = 20240501;
+
+    enum InputKind {
+        RANDOM,
+        IRREDUCIBLE_PRODUCT,
+        SPARSE,
+        REPEATED_FACTORS,
+    };
+
+    const char* kind_name(int kind) {
+        switch (kind) {
+            case RANDOM:
+                return "random";
+            case IRREDUCIBLE_PRODUCT:
+                return "irreducible_product";
+            case SPARSE:
+                return "sparse";
+            default:
+                return "repeated_factors";
+        }
+    }
+
+    Polynomial generate(int kind, int degree, ll modp, std::uint64_t seed) {
+        switch (kind) {
+            case RANDOM:
+                return Generators::random(degree, modp, seed);
+            case IRREDUCIBLE_PRODUCT:
+                return Generators::irreducible_product(degree, modp, seed);
+            case SPARSE:
+                return Generators::sparse(degree, modp, seed);
+            default:
+                return Generators::repeated_factors(degree, modp, seed);
+        }
+    }
+
+    ll prime(const benchmark::State& state) {
+        return Generators::primes()[state.range(0)];
+    }
+
+    void label(benchmark::State& state, ll modp, int degree) {
+        state.SetLabel("p=" + std::to_string(modp));
+        state.counters["degree"] = degree;
+        state.SetComplexityN(degree);
+    }
+
+    std::vector<std::int64_t> prime_indices() {
+        std::vector<std::int64_t> res;
+        for (size_t i = 0; i < Generators::primes().size(); i++) {
+            res.push_back((std::int64_t) i);
+        }
+        return res;
+    }
+
+    // Arithmetic sweeps up to 10^5, the matrix stages are quadratic in memory and stop at 2048
+    const std::vector<std::int64_t> ARITHMETIC_DEGREES{16, 128, 1024, 8192, 100000};
+    const std::vector<std::int64_t> MATRIX_DEGREES{16, 128, 512, 2048};
+    const std::vector<std::int64_t> FACTOR_DEGREES{16, 64, 256, 1024};
+}
+
+static void BM_Mul(benchmark::State& state) {
+    ll modp = prime(state);
+    int degree = (int) state.range(1);
+    auto a = Generators::random(degree, modp, SEED);
+    auto b = Generators::random(degree, modp, SEED + 1);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(a * b);
+    }
+    label(state, modp, degree);
+}
+BENCHMARK(BM_Mul)->ArgNames({"p", "d"})->ArgsProduct({prime_indices(), ARITHMETIC_DEGREES});
+
+static void BM_Mod(benchmark::State& state) {
+    ll modp = prime(state);
+    int degree = (int) state.range(1);
+    auto a = Generators::random(2 * degree - 1, modp, SEED);
+    auto b = Generators::random(degree, modp, SEED + 1);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(a % b);
+    }
+    label(state, modp, degree);
+}
+BENCHMARK(BM_Mod)->ArgNames({"p", "d"})->ArgsProduct({prime_indices(), ARITHMETIC_DEGREES});
+
+static void BM_Gcd(benchmark::State& state) {
+    ll modp = prime(state);
+    int degree = (int) state.range(1);
+    auto a = Generators::random(degree, modp, SEED);
+    auto b = Generators::random(degree - 1, modp, SEED + 1);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(Polynomial::gcd(a, b));
+    }
+    label(state, modp, degree);
+}
+BENCHMARK(BM_Gcd)->ArgNames({"p", "d"})->ArgsProduct({prime_indices(), ARITHMETIC_DEGREES});
+
+// x^p mod f, the Frobenius image every Q matrix starts from
+static void BM_Powmod(benchmark::State& state) {
+    ll modp = prime(state);
+    int degree = (int) state.range(1);
+    PolynomialModulus modulus(Generators::random(degree, modp, SEED));
+    Polynomial x(std::vector<ll>{0, 1}, modp);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(Polynomial::powmod(x, modp, modulus));
+    }
+    label(state, modp, degree);
+}
+BENCHMARK(BM_Powmod)->ArgNames({"p", "d"})->ArgsProduct({prime_indices(), ARITHMETIC_DEGREES});
+
+static void BM_CalculateQ(benchmark::State& state) {
+    ll modp = prime(state);
+    int degree = (int) state.range(1);
+    auto f = Generators::random(degree, modp, SEED);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(calculate_Q(f, modp));
+    }
+    label(state, modp, degree);
+}
+BENCHMARK(BM_CalculateQ)->ArgNames({"p", "d"})->ArgsProduct({prime_indices(), MATRIX_DEGREES})
+    ->Unit(benchmark::kMillisecond);
+
+static void BM_RowEchelonForm(benchmark::State& state) {
+    ll modp = prime(state);
+    int degree = (int) state.range(1);
+    Matrix Q = calculate_Q(Generators::random(degree, modp, SEED), modp);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(rowEchelonForm(Q));
+    }
+    label(state, modp, degree);
+}
+BENCHMARK(BM_RowEchelonForm)->ArgNames({"p", "d"})->ArgsProduct({prime_indices(), MATRIX_DEGREES})
+    ->Unit(benchmark::kMillisecond);
+
+// End to end over each input family, the stage breakdown of the last iteration is reported as counters
+static void BM_Factor(benchmark::State& state) {
+    ll modp = prime(state);
+    int degree = (int) state.range(1);
+    int kind = (int) state.range(2);
+    auto f = generate(kind, degree, modp, SEED);
+    BerlekampStats stats;
+    BerlekampOptions options;
+    options.stats = &stats;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(berlekamp_factor(f, modp, options));
+    }
+    label(state, modp, degree);
+    state.SetLabel("p=" + std::to_string(modp) + " " + kind_name(kind));
+    state.counters["squarefree_s"] = stats.squarefree_seconds;
+    state.counters["q_matrix_s"] = stats.q_matrix_seconds;
+    state.counters["elimination_s"] = stats.elimination_seconds;
+    state.counters["splitting_s"] = stats.splitting_seconds;
+    state.counters["nullity"] = stats.nullity;
+}
+BENCHMARK(BM_Factor)->ArgNames({"p", "d", "kind"})
+    ->ArgsProduct({prime_indices(), FACTOR_DEGREES, {RANDOM, IRREDUCIBLE_PRODUCT, SPARSE, REPEATED_FACTORS}})
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -1,10 +1,24 @@
 #include "Berlekamp.h"
+#include "CoefficientPool.h"
+#include "Composition.h"
+#include "FactorCache.h"
+#include "FieldContext.h"
 #include "Polynomial.h"
 #include "Matrix.h"
+#include "GF2.h"
+#include "KaltofenShoup.h"
+#include "PolynomialModulus.h"
+#include "Roots.h"
+#include "Stats.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+#include "Wiedemann.h"
 #include <algorithm>
 #include <chrono>
-#include <iostream>
 #include <cassert>
+#include <random>
+#include <stdexcept>
+#include <string>
 #include <unordered_map>
 
 using namespace std;
@@ -41,73 +55,48 @@ std::vector<std::pair<Polynomial, int>> squarefree_decompose(const Polynomial& p
     return result;
 }
 
-Matrix calculate_Q(const Polynomial &poly, const ll &modp) {//O(qd^2)
+namespace {
+    // Rows of Q per task when it is built in parallel, each task first pays one powmod to reach its first row
+    const int Q_ROWS_PER_TASK = 64;
+}
+
+Matrix calculate_Q(const Polynomial &poly, const ll &modp, ThreadPool* pool) {//O(log(q)M(d) + dM(d))
     int sz = poly.get_degree();
     Matrix res(sz, modp);
-    Polynomial p("1", modp);
-    auto cf = p.get_coeffs(sz);
-    for (int i = 0; i < sz; i++) {
-        res.set(0, i, cf[i]);
-    }
-    vector <ll> tmp(modp + 1, 0);
-    tmp[tmp.size() - 1] = 1;
-    auto pn = Polynomial(tmp, modp);
-    for (int i = 1; i < sz; i++) {
-        p = p * pn;
-        p = p % poly;
-        cf = p.get_coeffs(sz);
-        cout << "cf:\n";
-        for (auto c : cf) {
-            cout << c << " ";
-        }
-        cout << '\n';
-        for (int j = 0; j < sz; j++) {
-            res.set(i, j, cf[j]);
+    PolynomialModulus modulus(poly);
+    // Row i holds x^(iq) mod poly, so a single x^q mod poly is enough to step between rows
+    auto xq = Polynomial::powmod(Polynomial(vector<ll>{0, 1}, modp), modp, modulus);
+    int tasks = pool ? (sz + Q_ROWS_PER_TASK - 1) / Q_ROWS_PER_TASK : 1;
+    int rows_per_task = (sz + tasks - 1) / tasks;
+    parallel_for(pool, tasks, [&](size_t task) {
+        int first = (int) task * rows_per_task, last = min(sz, first + rows_per_task);
+        Polynomial p = Polynomial::powmod(xq, first, modulus);
+        for (int i = first; i < last; i++) {
+            if (i > first) {
+                p = p * xq;
+                p = Polynomial::mod(p, modulus);
+            }
+            auto cf = p.get_coeffs(sz);
+            for (int j = 0; j < sz; j++) {
+                res.set(i, j, cf[j]);
+            }
         }
-    }
+    });
     return res;
 }
 
-Matrix rowEchelonForm(Matrix M) {
-    int lead = 0;
-    int n = M.get_size();
-    for (int r = 0; r < n; r++) {
-        if (lead >= n) {
-            break;
-        }
-        int i = r;
-        while (M.get(i, lead) == 0) {
-            i++;
-            if (i == n) {
-                i = r;
-                lead++;
-                if (lead == n) {
-                    break;
-                }
-            }
-        }
-        M.swap_rows(i, r);
-        if (M.get(r, lead) != 0) {
-            M.divide_row(r, M.get(r, lead));
-        }
-        for (i = 0; i < n; i++) {
-            if (i != r) {
-                M.sub_rows(i, r, M.get(i, lead));
-            }
-        }
-        lead++;
-    }
+Matrix rowEchelonForm(Matrix M, ThreadPool* pool) {
+    M.row_echelon_form(pool);
     return M;
 }
 
 // Returns a list of vectors in the null space of (Q-I)^T
-std::vector<Polynomial> Q_eigenvectors(const Matrix &Q) {
-    cout << "Q:\n" << Q << "\n";
+std::vector<Polynomial> Q_eigenvectors(const Matrix &Q, ThreadPool* pool = nullptr) {
+    BERLEKAMP_TRACE(TraceLevel::Verbose, "Q", "\n" << Q);
     auto A = (Q - Matrix::identity(Q.get_size(), Q.get_modp())).get_transpose();
     // Gaussian elimination
-    cout << "A:\n" << A << "\n";
-    A = rowEchelonForm(A);
-    cout << "AFTER GAUSS:\n" << A << "\n";
+    A = rowEchelonForm(A, pool);
+    BERLEKAMP_TRACE(TraceLevel::Verbose, "elimination", "\n" << A);
     // Now we'll solve Au = 0
     int n = A.get_size();
     vector <int> pivots(n, -1);
@@ -143,56 +132,401 @@ std::vector<Polynomial> Q_eigenvectors(const Matrix &Q) {
             basis.emplace_back(vec, modp);
         }
     }
-    cout << "BASIS:\n";
-    for (const auto& vec : bas) {
-        for (auto el : vec) {
-            cout << el << ' ';
+    BERLEKAMP_TRACE(TraceLevel::Info, "null space", "dimension " << n << ", nullity " << basis.size());
+    if (Trace::enabled(TraceLevel::Verbose)) {
+        for (const auto& vec : basis) {
+            BERLEKAMP_TRACE(TraceLevel::Verbose, "null space", vec.to_string());
         }
-        cout << '\n';
     }
-    cout << "as poly:\n";
-    for (const auto& vec : basis) {
-        cout << vec.to_string() << '\n';
+    return basis;
+}
+
+namespace {
+    // Above this field size the exhaustive loop over residues costs more than a randomized round
+    const ll EXHAUSTIVE_SPLITTING_LIMIT = 64;
+    // Upper bound on the gcds of one chunk of the pooled exhaustive loop, keeps memory independent of modp
+    const ll EXHAUSTIVE_CHUNK_GCDS = 1024;
 
+    bool use_randomized_splitting(SplittingMode mode, const ll &modp) {
+        if (modp == 2) {
+            return false;
+        }
+        switch (mode) {
+            case SplittingMode::Exhaustive:
+                return false;
+            case SplittingMode::Randomized:
+                return true;
+            default:
+                return modp > EXHAUSTIVE_SPLITTING_LIMIT;
+        }
     }
-    return basis;
+
+    vector<Polynomial> split_exhaustive(const Polynomial &poly, const vector<Polynomial> &basis, const ll &modp,
+                                        ThreadPool* pool, BerlekampStats* stats) {
+        std::vector<Polynomial> factors{poly};
+        int k = 1;
+        while (factors.size() < basis.size()) {
+            if (stats) {
+                stats->splitting_rounds++;
+            }
+            std::vector<Polynomial> newfactors;
+            if (pool == nullptr) {
+                for (ll s = 0; s < modp; s++) {
+                    for (const auto& w : factors) {
+                        Polynomial ww = Polynomial::gcd(w, basis[k] - Polynomial(vector<ll>{s}, modp));
+                        if (!ww.is_one()) {
+                            newfactors.push_back(ww);
+                        }
+                    }
+                }
+            } else {
+                // gcds of a bounded range of s are computed into fixed slots and collected in (s, w) order,
+                // independent of scheduling, so memory does not grow with modp
+                ll chunk = max<ll>(1, EXHAUSTIVE_CHUNK_GCDS / (ll) factors.size());
+                std::vector<Polynomial> gcds;
+                for (ll first = 0; first < modp; first += chunk) {
+                    ll count = min(chunk, modp - first);
+                    gcds.assign(count * factors.size(), Polynomial());
+                    parallel_for(pool, gcds.size(), [&](size_t task) {
+                        ll s = first + (ll) (task / factors.size());
+                        const auto& w = factors[task % factors.size()];
+                        gcds[task] = Polynomial::gcd(w, basis[k] - Polynomial(vector<ll>{s}, modp));
+                    });
+                    for (const auto& ww : gcds) {
+                        if (!ww.is_one()) {
+                            newfactors.push_back(ww);
+                        }
+                    }
+                }
+            }
+            swap(factors, newfactors);
+            k += 1;
+        }
+        return factors;
+    }
+
+    // Cantor-Zassenhaus style splitting over the Berlekamp subalgebra: for a random v in it
+    // v^((q-1)/2) is 0 or +-1 modulo every irreducible factor, so gcd(w, v^((q-1)/2) - 1) splits w
+    // with probability at least 1/2 whenever w is reducible
+    vector<Polynomial> split_randomized(const Polynomial &poly, const vector<Polynomial> &basis, const ll &modp,
+                                        std::mt19937_64 &rng, ThreadPool* pool, BerlekampStats* stats) {
+        std::vector<Polynomial> factors{poly.normalize()};
+        std::uniform_int_distribution<ll> dist(0, modp - 1);
+        auto one = Polynomial::get_one(modp);
+        while (factors.size() < basis.size()) {
+            if (stats) {
+                stats->splitting_rounds++;
+            }
+            Polynomial v(vector<ll>{}, modp);
+            for (const auto& b : basis) {
+                v = v + b * Polynomial(vector<ll>{dist(rng)}, modp);
+            }
+            // The random draws above happen on this thread, so the split only depends on the seed
+            std::vector<std::vector<Polynomial>> parts(factors.size());
+            parallel_for(pool, factors.size(), [&](size_t i) {
+                const auto& w = factors[i];
+                if (w.get_degree() > 1) {
+                    PolynomialModulus modulus(w);
+                    auto h = Polynomial::powmod(Polynomial::mod(v, modulus), (modp - 1) / 2, modulus) - one;
+                    auto g = Polynomial::gcd(w, h);
+                    if (!h.is_zero() && !g.is_one() && g.get_degree() < w.get_degree()) {
+                        parts[i] = {g, Polynomial::div(w, g).normalize()};
+                        return;
+                    }
+                }
+                parts[i] = {w};
+            });
+            std::vector<Polynomial> newfactors;
+            for (const auto& part : parts) {
+                newfactors.insert(newfactors.end(), part.begin(), part.end());
+            }
+            swap(factors, newfactors);
+        }
+        return factors;
+    }
+}
+
+vector<pair<Polynomial, int>> distinct_degree_decompose(const Polynomial& poly) {
+    ll modp = poly.get_modp();
+    vector<pair<Polynomial, int>> result;
+    Polynomial f = poly.normalize();
+    Polynomial x(vector<ll>{0, 1}, modp);
+    // h = x^(p^i) mod f, reduced again whenever f loses the factors found so far
+    FrobeniusCache frobenius{PolynomialModulus(f)};
+    Polynomial h = Polynomial::mod(x, frobenius.get_modulus());
+    for (int i = 1; 2 * i <= f.get_degree(); i++) {
+        h = frobenius.apply(h);
+        auto g = Polynomial::gcd(f, h - x);
+        if (!g.is_one()) {
+            result.emplace_back(g, i);
+            f = Polynomial::div(f, g);
+            frobenius = FrobeniusCache(PolynomialModulus(f), frobenius.power(1));
+            h = Polynomial::mod(h, frobenius.get_modulus());
+        }
+    }
+    // What is left has no factor of degree at most half its own, so it is irreducible
+    if (f.get_degree() > 0) {
+        result.emplace_back(f.normalize(), f.get_degree());
+    }
+    return result;
 }
 
-vector<Polynomial> factor(const Polynomial &poly, const ll &modp) {
-    cout << "DECOMPOSING:\n";
-    cout << poly.to_string() << '\n';
+bool is_irreducible(const Polynomial& poly) {
+    int n = poly.get_degree();
+    if (n <= 0) {
+        return false;
+    }
+    ll modp = poly.get_modp();
+    Polynomial x(vector<ll>{0, 1}, modp);
+    FrobeniusCache frobenius{PolynomialModulus(poly)};
+    Polynomial h = Polynomial::mod(x, frobenius.get_modulus());
+    // Ben-Or: f is irreducible iff gcd(f, x^(p^i) - x) = 1 for every i <= n / 2. Random polynomials have
+    // a small factor with high probability, so the usual reducible input stops after a few steps.
+    for (int i = 1; 2 * i <= n; i++) {
+        h = frobenius.apply(h);
+        if (!Polynomial::gcd(poly, h - x).is_one()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Berlekamp's algorithm on one squarefree polynomial. The splitting RNG is seeded from
+// (seed, part, degree), so the result only depends on the options and the position of poly.
+vector<Polynomial> factor_berlekamp(const Polynomial &poly, const ll &modp, const BerlekampOptions &options,
+                                    std::uint64_t part, int degree, ThreadPool* pool, BerlekampStats* stats) {
     if ( poly.get_degree() <= 1 ) {
         return std::vector<Polynomial>{poly};
     }
-    auto Q = calculate_Q(poly, modp);
-    auto basis = Q_eigenvectors(Q);
-    std::vector<Polynomial> factors{poly};
-    int k = 1;
-    while (factors.size() < basis.size()) {
-        std::vector<Polynomial> newfactors;
-        for (int s = 0; s < modp; s++) {
-            for (const auto& w : factors) {
-                Polynomial ww = Polynomial::gcd(w, basis[k] - Polynomial(vector<ll>{s}, modp));
-                if (!ww.is_one()) {
-                    newfactors.push_back(ww);
-                }
+    // Every squarefree part gets its own stream so the result only depends on the seed
+    std::seed_seq seq{static_cast<std::uint32_t>(options.seed), static_cast<std::uint32_t>(options.seed >> 32),
+                      static_cast<std::uint32_t>(part), static_cast<std::uint32_t>(degree)};
+    std::mt19937_64 rng(seq);
+    vector<Polynomial> basis;
+    if (options.null_space == NullSpaceMethod::Wiedemann) {
+        StageTimer timer(stats ? &stats->elimination_seconds : nullptr);
+        basis = wiedemann_basis(poly, degree, rng);
+    } else {
+        Matrix Q(0, modp);
+        {
+            StageTimer timer(stats ? &stats->q_matrix_seconds : nullptr);
+            Q = calculate_Q(poly, modp, pool);
+        }
+        StageTimer timer(stats ? &stats->elimination_seconds : nullptr);
+        basis = Q_eigenvectors(Q, pool);
+        if (stats) {
+            stats->peak_matrix_size = max(stats->peak_matrix_size, Q.get_size());
+        }
+    }
+    StageTimer timer(stats ? &stats->splitting_seconds : nullptr);
+    if (stats) {
+        stats->nullity += (int) basis.size();
+    }
+    if (use_randomized_splitting(options.splitting, modp)) {
+        return split_randomized(poly, basis, modp, rng, pool, stats);
+    }
+    return split_exhaustive(poly, basis, modp, pool, stats);
+}
+
+// Kaltofen-Shoup on one squarefree polynomial, every distinct-degree piece is split with its own RNG stream
+vector<Polynomial> factor_kaltofen_shoup(const Polynomial &poly, const BerlekampOptions &options, std::uint64_t part,
+                                         ThreadPool* pool, BerlekampStats* stats) {
+    if (poly.get_degree() <= 1) {
+        return std::vector<Polynomial>{poly};
+    }
+    vector<pair<Polynomial, int>> pieces;
+    {
+        StageTimer timer(stats ? &stats->distinct_degree_seconds : nullptr);
+        pieces = distinct_degree_decompose_bsgs(poly);
+    }
+    BERLEKAMP_TRACE(TraceLevel::Info, "distinct degree", pieces.size() << " pieces");
+    vector<vector<Polynomial>> factors(pieces.size());
+    vector<BerlekampStats> piece_stats(stats ? pieces.size() : 0);
+    parallel_for(pool, pieces.size(), [&](size_t i) {
+        StageTimer timer(stats ? &piece_stats[i].splitting_seconds : nullptr);
+        std::seed_seq seq{static_cast<std::uint32_t>(options.seed), static_cast<std::uint32_t>(options.seed >> 32),
+                          static_cast<std::uint32_t>(part), static_cast<std::uint32_t>(pieces[i].second)};
+        std::mt19937_64 rng(seq);
+        factors[i] = equal_degree_split(pieces[i].first, pieces[i].second, rng);
+    });
+    vector<Polynomial> result;
+    for (size_t i = 0; i < pieces.size(); i++) {
+        result.insert(result.end(), factors[i].begin(), factors[i].end());
+        if (stats) {
+            stats->merge(piece_stats[i]);
+            stats->nullity += (int) factors[i].size();
+        }
+    }
+    return result;
+}
+
+vector<Polynomial> factor(const Polynomial &poly, const ll &modp, const BerlekampOptions &options, std::uint64_t part,
+                          ThreadPool* pool, BerlekampStats* stats) {
+    BERLEKAMP_TRACE(TraceLevel::Info, "factor", "squarefree part " << part << " of degree " << poly.get_degree());
+    BERLEKAMP_TRACE(TraceLevel::Debug, "factor", poly.to_string());
+    vector<Polynomial> result;
+    Polynomial rest = poly;
+    if (options.extract_roots && poly.get_degree() > 1) {
+        StageTimer timer(stats ? &stats->root_finding_seconds : nullptr);
+        auto g = linear_part(poly);
+        for (ll root : split_linear_part(g, options.seed ^ part)) {
+            result.emplace_back(vector<ll>{root == 0 ? 0 : modp - root, 1}, modp);
+        }
+        if (stats) {
+            stats->nullity += (int) result.size();
+        }
+        BERLEKAMP_TRACE(TraceLevel::Info, "roots", result.size() << " linear factors");
+        if (!result.empty()) {
+            rest = Polynomial::div(poly, g);
+        }
+        if (rest.get_degree() <= 0) {
+            return result;
+        }
+    }
+    if (options.method == FactorizationMethod::KaltofenShoup) {
+        auto factors = factor_kaltofen_shoup(rest, options, part, pool, stats);
+        result.insert(result.end(), factors.begin(), factors.end());
+        return result;
+    }
+    bool distinct_degree = options.distinct_degree || options.null_space == NullSpaceMethod::Wiedemann;
+    if (!distinct_degree || rest.get_degree() <= 1) {
+        auto factors = factor_berlekamp(rest, modp, options, part, 0, pool, stats);
+        result.insert(result.end(), factors.begin(), factors.end());
+        return result;
+    }
+
+    vector<pair<Polynomial, int>> pieces;
+    {
+        StageTimer timer(stats ? &stats->distinct_degree_seconds : nullptr);
+        pieces = distinct_degree_decompose(rest);
+    }
+    BERLEKAMP_TRACE(TraceLevel::Info, "distinct degree", pieces.size() << " pieces");
+    // A piece of degree i holding factors of degree i is one irreducible factor and needs no matrix
+    vector<vector<Polynomial>> factors(pieces.size());
+    vector<BerlekampStats> piece_stats(stats ? pieces.size() : 0);
+    parallel_for(pool, pieces.size(), [&](size_t i) {
+        const auto& piece = pieces[i];
+        if (piece.first.get_degree() == piece.second) {
+            factors[i] = {piece.first};
+            if (stats) {
+                piece_stats[i].nullity = 1;
             }
+            return;
+        }
+        factors[i] = factor_berlekamp(piece.first, modp, options, part, piece.second, pool,
+                                      stats ? &piece_stats[i] : nullptr);
+    });
+    for (size_t i = 0; i < pieces.size(); i++) {
+        result.insert(result.end(), factors[i].begin(), factors[i].end());
+        if (stats) {
+            stats->merge(piece_stats[i]);
         }
-        swap(factors, newfactors);
-        k += 1;
     }
-    return factors;
+    return result;
 }
 
-vector<pair<Polynomial, int>> berlekamp_factor(const Polynomial& poly, const ll& modp) {
+vector<pair<Polynomial, int>> berlekamp_factor(const Polynomial& poly, const ll& modp, const BerlekampOptions& options) {
+    BerlekampStats* stats = options.stats;
+    if (stats) {
+        *stats = BerlekampStats();
+    }
+    if (options.cache) {
+        // The cache keys on the field of poly, which must be the one the factorization is computed in
+        if (poly.get_modp() != modp) {
+            throw std::invalid_argument("polynomial over GF(" + std::to_string(poly.get_modp())
+                                        + ") factored over GF(" + std::to_string(modp) + ")");
+        }
+        vector<pair<Polynomial, int>> result;
+        if (options.cache->lookup(poly, result)) {
+            BERLEKAMP_TRACE(TraceLevel::Info, "cache", "hit for degree " << poly.get_degree());
+            return result;
+        }
+        BerlekampOptions uncached = options;
+        uncached.cache = nullptr;
+        result = berlekamp_factor(poly, modp, uncached);
+        options.cache->insert(poly, result);
+        return result;
+    }
+    StageTimer total_timer(stats ? &stats->total_seconds : nullptr);
+    OperationCounters counters;
+    CountingScope counting(stats ? &counters : OperationCounters::current());
+    std::unique_ptr<CoefficientPool::Scope> pool_scope(options.pooled_allocation ? new CoefficientPool::Scope() : nullptr);
+    // An explicitly requested method, null space or stage takes precedence over the GF(2) backend
+    bool gf2 = modp == 2 && options.gf2_backend && options.method == FactorizationMethod::Berlekamp
+            && options.null_space == NullSpaceMethod::Dense && !options.extract_roots && !options.distinct_degree;
+    if (gf2) {
+        auto result = berlekamp_factor_gf2(poly);
+        if (stats) {
+            stats->nullity = (int) result.size();
+        }
+        return result;
+    }
+    std::unique_ptr<ThreadPool> own_pool;
+    ThreadPool* pool = options.pool;
+    if (pool == nullptr && options.threads != 1) {
+        own_pool.reset(new ThreadPool(options.threads));
+        pool = own_pool.get();
+    }
+
     vector<pair<Polynomial, int>> result;
-    vector<pair<Polynomial, int>> sqrfree = squarefree_decompose(poly);
-    for (auto const& value : sqrfree) {
-        auto r1 = factor(value.first, modp);
-        for (const auto& i : r1) {
-            result.emplace_back(i, value.second);
+    vector<pair<Polynomial, int>> sqrfree;
+    {
+        StageTimer timer(stats ? &stats->squarefree_seconds : nullptr);
+        sqrfree = squarefree_decompose(poly);
+    }
+    BERLEKAMP_TRACE(TraceLevel::Info, "squarefree", "degree " << poly.get_degree() << ", "
+                    << sqrfree.size() << " squarefree parts");
+    vector<vector<Polynomial>> factors(sqrfree.size());
+    vector<BerlekampStats> part_stats(stats ? sqrfree.size() : 0);
+    parallel_for(pool, sqrfree.size(), [&](size_t part) {
+        factors[part] = factor(sqrfree[part].first, modp, options, part, pool, stats ? &part_stats[part] : nullptr);
+    });
+    for (size_t part = 0; part < sqrfree.size(); part++) {
+        for (const auto& i : factors[part]) {
+            result.emplace_back(i, sqrfree[part].second);
+        }
+    }
+    if (stats) {
+        for (const auto& s : part_stats) {
+            stats->merge(s);
         }
+        counters.store(*stats);
     }
     return result;
+}
+
+vector<vector<pair<Polynomial, int>>> berlekamp_factor_batch(const Polynomial* polys, size_t count, const ll& modp,
+                                                             const BerlekampOptions& options) {
+    std::unique_ptr<ThreadPool> own_pool;
+    ThreadPool* pool = options.pool;
+    if (pool == nullptr && options.threads != 1) {
+        own_pool.reset(new ThreadPool(options.threads));
+        pool = own_pool.get();
+    }
+    // Build the shared context up front instead of racing for it from every worker
+    FieldContext::get(modp);
+
+    BerlekampOptions single = options;
+    single.pool = nullptr;
+    single.threads = 1;
+    vector<vector<pair<Polynomial, int>>> result(count);
+    vector<BerlekampStats> job_stats(options.stats ? count : 0);
+    size_t grain = pool == nullptr ? 1 : max<size_t>(1, count / (16 * (size_t) pool->get_size()));
+    parallel_for(pool, count, [&](size_t i) {
+        BerlekampOptions job = single;
+        job.stats = options.stats ? &job_stats[i] : nullptr;
+        result[i] = berlekamp_factor(polys[i], modp, job);
+    }, grain);
+    if (options.stats) {
+        *options.stats = BerlekampStats();
+        for (const auto& s : job_stats) {
+            options.stats->merge(s);
+        }
+    }
+    return result;
+}
 
+vector<vector<pair<Polynomial, int>>> berlekamp_factor_batch(const vector<Polynomial>& polys, const ll& modp,
+                                                             const BerlekampOptions& options) {
+    return berlekamp_factor_batch(polys.data(), polys.size(), modp, options);
 }
@@ -1,7 +1,104 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <vector>
 
 #include "Polynomial.h"
+#include "Stats.h"
 
-std::vector<std::pair<Polynomial, int>> berlekamp_factor(const Polynomial& poly, const ll& modp);
+class FactorCache;
+class Matrix;
+class ThreadPool;
+
+// How factor() splits a squarefree polynomial once the Berlekamp basis is known.
+// Exhaustive tries gcd(w, v - s) for every field element s, which is O(q) gcds per basis vector.
+// Randomized takes random combinations v of the basis and uses gcd(w, v^((q-1)/2) - 1),
+// which costs O(log q) multiplications per round; it needs an odd q and falls back to Exhaustive for q = 2.
+// Automatic picks Randomized once the field is large enough for the exhaustive loop to dominate.
+enum class SplittingMode {
+    Automatic,
+    Exhaustive,
+    Randomized,
+};
+
+// Which algorithm factor() runs on every squarefree part.
+// Berlekamp finds the basis of the Berlekamp subalgebra (see NullSpaceMethod) and splits with it.
+// KaltofenShoup runs baby-step/giant-step distinct-degree factorization and Cantor-Zassenhaus
+// equal-degree splitting on top of modular composition (KaltofenShoup.h). It needs no matrix at all
+// and wins for high degrees over large primes.
+enum class FactorizationMethod {
+    Berlekamp,
+    KaltofenShoup,
+};
+
+// How factor() finds the Berlekamp basis, the null space of Q - I.
+// Dense builds the d x d matrix Q and eliminates it, O(d^2) memory and O(d^3) time.
+// Wiedemann never stores Q: it applies v -> v^p mod f - v by powmod as a black box (see Wiedemann.h),
+// O(d) memory besides the basis itself and O(d) black-box applications per basis vector. It runs on the
+// distinct-degree pieces, whose factor count is known, so it implies distinct_degree.
+enum class NullSpaceMethod {
+    Dense,
+    Wiedemann,
+};
+
+struct BerlekampOptions {
+    SplittingMode splitting = SplittingMode::Automatic;
+    // Seed of the splitting RNG, a fixed seed gives reproducible results
+    std::uint64_t seed = 0;
+    // Factor over GF(2) with the bit-packed backend from GF2.h. It is only used with the default method
+    // and null_space and without extract_roots or distinct_degree, any of those runs on Polynomial instead.
+    // The backend runs on the calling thread and ignores splitting, seed, threads, pool and pooled_allocation.
+    bool gf2_backend = true;
+    // Workers for the squarefree parts, the Q matrix, the elimination and the splitting gcds:
+    // 1 runs everything on the calling thread, 0 uses every hardware thread.
+    // The result does not depend on the worker count.
+    int threads = 1;
+    // Runs the parallel stages on this pool instead of one created per call, threads is then ignored
+    ThreadPool* pool = nullptr;
+    // Splits every squarefree part by the degrees of its irreducible factors before Berlekamp, which then
+    // only sees products of equal-degree factors and skips pieces that are already irreducible.
+    // Pays off when the factors have many different degrees.
+    bool distinct_degree = false;
+    FactorizationMethod method = FactorizationMethod::Berlekamp;
+    NullSpaceMethod null_space = NullSpaceMethod::Dense;
+    // Takes the linear factors of every squarefree part out with find_roots first, so only the
+    // cofactor goes through the Q matrix. Pays off for inputs that are mostly linear factors.
+    bool extract_roots = false;
+    // Recycles coefficient buffers through CoefficientPool for the duration of the call
+    bool pooled_allocation = true;
+    // Receives per-stage times and operation counts of the call when set; batches report the sum over their inputs
+    BerlekampStats* stats = nullptr;
+    // Answers repeated inputs from this cache and stores new results in it; a hit leaves stats zeroed.
+    // berlekamp_factor then throws std::invalid_argument when poly is not over GF(modp)
+    FactorCache* cache = nullptr;
+};
+
+// Stages of berlekamp_factor, exposed for benchmarks
+std::vector<std::pair<Polynomial, int>> squarefree_decompose(const Polynomial& poly);
+
+// Row i holds the coefficients of x^(i * modp) mod poly
+Matrix calculate_Q(const Polynomial& poly, const ll& modp, ThreadPool* pool = nullptr);
+
+Matrix rowEchelonForm(Matrix M, ThreadPool* pool = nullptr);
+
+// Splits a squarefree polynomial into pairs (g, i), g the monic product of all its irreducible factors of degree i,
+// by gcd(f, x^(p^i) - x) for increasing i
+std::vector<std::pair<Polynomial, int>> distinct_degree_decompose(const Polynomial& poly);
+
+// Ben-Or's test, stops at the first i with a factor of degree i instead of building the Q matrix
+bool is_irreducible(const Polynomial& poly);
+
+std::vector<std::pair<Polynomial, int>> berlekamp_factor(const Polynomial& poly, const ll& modp,
+                                                         const BerlekampOptions& options = BerlekampOptions());
+
+// Factors count polynomials over the same field, result i belongs to polys[i].
+// The polynomials are spread over the workers of options.pool (or options.threads) and each one
+// is factored on a single thread, so a batch of small inputs scales with the worker count.
+// Per-modulus precomputation (FieldContext, NTT roots) is built once and shared by all of them.
+std::vector<std::vector<std::pair<Polynomial, int>>> berlekamp_factor_batch(
+        const Polynomial* polys, std::size_t count, const ll& modp,
+        const BerlekampOptions& options = BerlekampOptions());
+
+std::vector<std::vector<std::pair<Polynomial, int>>> berlekamp_factor_batch(
+        const std::vector<Polynomial>& polys, const ll& modp, const BerlekampOptions& options = BerlekampOptions());
@@ -0,0 +1,92 @@
+#include "CoefficientPool.h"
+
+using namespace std;
+
+namespace {
+    const int CLASSES = 40;
+    // Buffers kept per capacity class
+    const size_t MAX_PER_CLASS = 8;
+
+    struct State {
+        size_t pooled_bytes = 0;
+        vector<vector<ll>> free[CLASSES];
+    };
+
+    // Kept apart from State so that polynomials destroyed at thread exit, after State, can still check it
+    thread_local int depth = 0;
+    thread_local State state;
+
+    // Class k holds capacities in [2^k, 2^(k + 1))
+    int floor_log2(size_t n) {
+        int k = 0;
+        while ((n >> (k + 1)) != 0) {
+            k++;
+        }
+        return k;
+    }
+
+    int ceil_log2(size_t n) {
+        int k = floor_log2(n);
+        return ((size_t) 1 << k) < n ? k + 1 : k;
+    }
+}
+
+CoefficientPool::Scope::Scope() {
+    depth++;
+}
+
+CoefficientPool::Scope::~Scope() {
+    if (--depth == 0) {
+        for (auto& list : state.free) {
+            list.clear();
+            list.shrink_to_fit();
+        }
+        state.pooled_bytes = 0;
+    }
+}
+
+bool CoefficientPool::active() {
+    return depth > 0;
+}
+
+vector<ll> CoefficientPool::acquire(size_t n) {
+    vector<ll> res;
+    if (n == 0) {
+        return res;
+    }
+    if (depth == 0) {
+        res.reserve(n);
+        return res;
+    }
+    int k = ceil_log2(n);
+    if (k < CLASSES && !state.free[k].empty()) {
+        res.swap(state.free[k].back());
+        state.free[k].pop_back();
+        state.pooled_bytes -= res.capacity() * sizeof(ll);
+        return res;
+    }
+    // Round up so the buffer comes back to a class that serves requests of this size
+    res.reserve(k < CLASSES ? (size_t) 1 << k : n);
+    return res;
+}
+
+vector<ll> CoefficientPool::acquire_zeros(size_t n) {
+    vector<ll> res = acquire(n);
+    res.assign(n, 0);
+    return res;
+}
+
+void CoefficientPool::release(vector<ll>& buffer) {
+    if (depth == 0 || buffer.capacity() == 0) {
+        return;
+    }
+    size_t bytes = buffer.capacity() * sizeof(ll);
+    int k = floor_log2(buffer.capacity());
+    if (k >= CLASSES || state.free[k].size() >= MAX_PER_CLASS || state.pooled_bytes + bytes > MAX_POOLED_BYTES) {
+        return;
+    }
+    buffer.clear();
+    state.free[k].emplace_back();
+    state.free[k].back().swap(buffer);
+    state.pooled_bytes += bytes;
+}
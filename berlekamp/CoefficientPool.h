@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "Polynomial.h"
+
+// Thread-local free lists of coefficient buffers, by power-of-two capacity class.
+// While a Scope is alive on the thread, destroyed polynomials hand their storage to the pool
+// and new results take it back from there, so the gcd and powmod loops stop going to the allocator.
+// Without a Scope acquire is a plain allocation and release does nothing.
+class CoefficientPool {
+public:
+    // Scopes nest; the outermost one frees everything it has pooled when it ends
+    class Scope {
+    public:
+        Scope();
+
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+
+        Scope& operator=(const Scope&) = delete;
+    };
+
+    static bool active();
+
+    // Empty vector with capacity at least n
+    static std::vector<ll> acquire(std::size_t n);
+
+    // acquire(n) resized to n zeros
+    static std::vector<ll> acquire_zeros(std::size_t n);
+
+    // Takes the storage of buffer, which is left empty
+    static void release(std::vector<ll>& buffer);
+
+    // A thread keeps at most this much pooled memory, larger buffers are not kept at all
+    static const std::size_t MAX_POOLED_BYTES = 64 << 20;
+};
@@ -0,0 +1,110 @@
+#include "Composition.h"
+#include "Modular.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+using namespace std;
+
+namespace {
+    // Each Horner step costs a multiplication mod f while the table product is plain field arithmetic,
+    // so BABY_STEP_FACTOR * sqrt(n) baby steps beat the textbook sqrt(n) once the table is reused
+    const int BABY_STEP_FACTOR = 4;
+}
+
+ModularComposition::ModularComposition(const Polynomial& h, const PolynomialModulus& modulus) : modulus(modulus),
+    h(modulus.reduce(h)), n(modulus.get_degree()), steps(1) {
+    assert(n > 0);
+    while (steps < n && steps * steps < BABY_STEP_FACTOR * BABY_STEP_FACTOR * n) {
+        steps++;
+    }
+    table.assign((size_t) steps * n, 0);
+    Polynomial power = modulus.reduce(Polynomial::get_one(modulus.get_modp()));
+    for (int i = 0; i < steps; i++) {
+        auto c = power.get_coeffs(n);
+        copy(c.begin(), c.end(), table.begin() + (size_t) i * n);
+        power.mulmod_inplace(this->h, modulus);
+    }
+    giant = move(power);
+}
+
+Polynomial ModularComposition::compose(const Polynomial& g) const {
+    ll modp = modulus.get_modp();
+    if (g.get_degree() <= 0) {
+        return g;
+    }
+    int length = g.get_degree() + 1;
+    auto c = g.get_coeffs(length);
+    int blocks = (length + steps - 1) / steps;
+    // blocks x steps coefficient matrix times the steps x n table of baby steps
+    vector<vector<ll>> block(blocks, vector<ll>(n));
+    with_field(modp, [&](const auto& field) {
+        ull p = field.modulus();
+        // While steps * (p - 1)^2 fits into 64 bits every sum can be reduced once at the end
+        bool lazy = (u128) (p - 1) * (p - 1) * steps < ((u128) 1 << 63);
+        vector<ull> acc(n);
+        for (int j = 0; j < blocks; j++) {
+            fill(acc.begin(), acc.end(), 0);
+            for (int i = 0; i < steps && j * steps + i < length; i++) {
+                ull ai = (ull) c[j * steps + i];
+                if (ai == 0) continue;
+                const ll* row = &table[(size_t) i * n];
+                if (lazy) {
+                    for (int t = 0; t < n; t++) {
+                        acc[t] += ai * (ull) row[t];
+                    }
+                } else {
+                    for (int t = 0; t < n; t++) {
+                        acc[t] = field.mul_add(acc[t], ai, (ull) row[t]);
+                    }
+                }
+            }
+            for (int t = 0; t < n; t++) {
+                block[j][t] = (ll) (lazy ? field.reduce(acc[t]) : acc[t]);
+            }
+        }
+    });
+    Polynomial res(move(block[blocks - 1]), modp);
+    for (int j = blocks - 2; j >= 0; j--) {
+        res.mulmod_inplace(giant, modulus);
+        res += Polynomial(move(block[j]), modp);
+    }
+    return res;
+}
+
+bool FrobeniusCache::uses_composition(ll modp, int degree) {
+    int bits = 0;
+    while ((modp >> bits) > 1) {
+        bits++;
+    }
+    // powmod takes about 1.5 log2(p) multiplications mod f, a composition about sqrt(n) / BABY_STEP_FACTOR
+    // plus the O(n^2) table product; measured crossover
+    return 6 * bits >= sqrt((double) degree) + 8;
+}
+
+FrobeniusCache::FrobeniusCache(const PolynomialModulus& modulus) : FrobeniusCache(modulus,
+    Polynomial::powmod(Polynomial(vector<ll>{0, 1}, modulus.get_modp()), modulus.get_modp(), modulus)) {}
+
+FrobeniusCache::FrobeniusCache(const PolynomialModulus& modulus, const Polynomial& xp) : modulus(modulus) {
+    ll modp = modulus.get_modp();
+    powers.push_back(modulus.reduce(Polynomial(vector<ll>{0, 1}, modp)));
+    powers.push_back(modulus.reduce(xp));
+    if (modulus.get_degree() > 0 && uses_composition(modp, modulus.get_degree())) {
+        composition.reset(new ModularComposition(powers[1], modulus));
+    }
+}
+
+Polynomial FrobeniusCache::apply(const Polynomial& v) const {
+    if (composition) {
+        return composition->compose(v);
+    }
+    return Polynomial::powmod(v, modulus.get_modp(), modulus);
+}
+
+const Polynomial& FrobeniusCache::power(int i) {
+    while ((int) powers.size() <= i) {
+        powers.push_back(apply(powers.back()));
+    }
+    return powers[i];
+}
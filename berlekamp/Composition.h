@@ -0,0 +1,67 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "Polynomial.h"
+#include "PolynomialModulus.h"
+
+// Brent-Kung modular composition g(h) mod f for a fixed h. The baby steps 1, h, ..., h^(m-1), m = O(sqrt(n)),
+// are kept as the rows of an m x n table. g is cut into blocks of m coefficients, all block polynomials
+// sum_i g[jm + i] h^i come out of one (n / m) x m by m x n matrix product, and Horner in h^m joins them.
+// A composition costs O(sqrt(n)) multiplications mod f plus O(n^2) field operations, the table O(n^1.5) memory.
+class ModularComposition {
+public:
+    ModularComposition(const Polynomial& h, const PolynomialModulus& modulus);
+
+    // g(h) mod f, g may have any degree; each further block of g costs one more multiplication mod f
+    Polynomial compose(const Polynomial& g) const;
+
+    const Polynomial& get_inner() const {
+        return h;
+    }
+
+    const PolynomialModulus& get_modulus() const {
+        return modulus;
+    }
+
+private:
+    PolynomialModulus modulus;
+    Polynomial h;
+    int n;
+    int steps;
+    // Row i holds the n coefficients of h^i mod f
+    std::vector<ll> table;
+    // h^steps mod f
+    Polynomial giant;
+};
+
+// Frobenius map v -> v^p mod f. Over GF(p) v(x)^p = v(x^p), so once x^p mod f is known the map is a
+// composition with it and costs no O(log p) powmod. For small p, where log p squarings are cheaper than
+// a composition, it stays a powmod. power(i) = x^(p^i) mod f is kept for every i asked for so far.
+class FrobeniusCache {
+public:
+    explicit FrobeniusCache(const PolynomialModulus& modulus);
+
+    // xp must be x^p mod f, e.g. x^p mod a multiple of f reduced to f
+    FrobeniusCache(const PolynomialModulus& modulus, const Polynomial& xp);
+
+    // v^p mod f
+    Polynomial apply(const Polynomial& v) const;
+
+    // x^(p^i) mod f
+    const Polynomial& power(int i);
+
+    const PolynomialModulus& get_modulus() const {
+        return modulus;
+    }
+
+    // Whether apply composes with x^p mod f rather than raising to the power p
+    static bool uses_composition(ll modp, int degree);
+
+private:
+    PolynomialModulus modulus;
+    std::vector<Polynomial> powers;
+    // Composition with x^p mod f, null when apply uses powmod
+    std::unique_ptr<ModularComposition> composition;
+};
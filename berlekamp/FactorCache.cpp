@@ -0,0 +1,118 @@
+#include "FactorCache.h"
+#include "PolynomialFile.h"
+
+#include <cstdio>
+#include <stdexcept>
+
+using namespace std;
+
+FactorCache::FactorCache(size_t capacity) : capacity(capacity), hits(0), misses(0) {
+    if (capacity == 0) {
+        throw invalid_argument("factor cache capacity must be positive");
+    }
+}
+
+uint64_t FactorCache::hash(const Polynomial& poly) {
+    // splitmix64 finalizer over a running combination of the words
+    auto mix = [](uint64_t x) {
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ULL;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    };
+    uint64_t h = mix((uint64_t) poly.get_modp());
+    for (ll c : poly.get_coeffs(0)) {
+        h = mix(h + 0x9e3779b97f4a7c15ULL + (uint64_t) c);
+    }
+    return h;
+}
+
+bool FactorCache::lookup(const Polynomial& poly, Factorization& result) {
+    lock_guard<mutex> guard(lock);
+    auto it = index.find(poly);
+    if (it == index.end()) {
+        misses++;
+        return false;
+    }
+    hits++;
+    entries.splice(entries.begin(), entries, it->second);
+    result = it->second->second;
+    return true;
+}
+
+void FactorCache::insert(const Polynomial& poly, const Factorization& factors) {
+    lock_guard<mutex> guard(lock);
+    insert_locked(poly, factors);
+}
+
+void FactorCache::insert_locked(const Polynomial& poly, const Factorization& factors) {
+    auto it = index.find(poly);
+    if (it != index.end()) {
+        it->second->second = factors;
+        entries.splice(entries.begin(), entries, it->second);
+        return;
+    }
+    if (entries.size() == capacity) {
+        index.erase(entries.back().first);
+        entries.pop_back();
+    }
+    entries.emplace_front(poly, factors);
+    index.emplace(poly, entries.begin());
+}
+
+size_t FactorCache::size() const {
+    lock_guard<mutex> guard(lock);
+    return entries.size();
+}
+
+void FactorCache::clear() {
+    lock_guard<mutex> guard(lock);
+    entries.clear();
+    index.clear();
+}
+
+bool FactorCache::save(const string& path) const {
+    // The file is written from a snapshot, lookups and inserts are not blocked by the I/O
+    vector<pair<Polynomial, Factorization>> snapshot;
+    {
+        lock_guard<mutex> guard(lock);
+        snapshot.assign(entries.begin(), entries.end());
+    }
+    string tmp = path + ".tmp";
+    PolynomialFileWriter writer;
+    if (!writer.open(tmp)) {
+        return false;
+    }
+    for (const auto& entry : snapshot) {
+        writer.write(entry.first);
+        writer.write(entry.second);
+    }
+    if (!writer.close() || rename(tmp.c_str(), path.c_str()) != 0) {
+        remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool FactorCache::load(const string& path) {
+    PolynomialFileReader reader;
+    if (!reader.open(path)) {
+        return false;
+    }
+    const auto& polys = reader.get_polynomials();
+    const auto& factorizations = reader.get_factorizations();
+    if (polys.size() != factorizations.size()) {
+        return false;
+    }
+    lock_guard<mutex> guard(lock);
+    // The file lists the most recently used entry first, so they are inserted from the back
+    for (size_t i = polys.size(); i-- > 0;) {
+        Factorization factors;
+        for (const auto& factor : factorizations[i]) {
+            factors.emplace_back(factor.first.to_polynomial(), factor.second);
+        }
+        insert_locked(polys[i].to_polynomial(), factors);
+    }
+    return true;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "Polynomial.h"
+
+// Bounded LRU cache of factorizations, keyed by the polynomial and its modulus. berlekamp_factor consults it
+// when BerlekampOptions::cache points here, so repeated inputs skip every stage. All methods are thread-safe.
+// save writes the entries as a polynomial file (PolynomialFile.h), each polynomial followed by its
+// factorization, most recently used first; load maps such a file and inserts its entries, so a restarted
+// process starts warm.
+class FactorCache {
+public:
+    typedef std::vector<std::pair<Polynomial, int>> Factorization;
+
+    // Throws std::invalid_argument for a capacity of zero
+    explicit FactorCache(std::size_t capacity = 1024);
+
+    // Copies the cached factorization of poly to result and marks it most recently used
+    bool lookup(const Polynomial& poly, Factorization& result);
+
+    // Evicts the least recently used entry when the cache is full
+    void insert(const Polynomial& poly, const Factorization& factors);
+
+    std::size_t size() const;
+
+    std::size_t get_capacity() const {
+        return capacity;
+    }
+
+    void clear();
+
+    std::uint64_t get_hits() const {
+        return hits;
+    }
+
+    std::uint64_t get_misses() const {
+        return misses;
+    }
+
+    // Writes to path + ".tmp" and renames, so readers never see a partial file; false on I/O errors
+    bool save(const std::string& path) const;
+
+    // Inserts the entries of a file written by save; false and nothing inserted if it is missing or malformed
+    bool load(const std::string& path);
+
+    // Hash of the coefficients and the modulus
+    static std::uint64_t hash(const Polynomial& poly);
+
+private:
+    struct KeyHash {
+        std::size_t operator()(const Polynomial& poly) const {
+            return (std::size_t) hash(poly);
+        }
+    };
+
+    // Polynomial's == ignores the modulus
+    struct KeyEqual {
+        bool operator()(const Polynomial& a, const Polynomial& b) const {
+            return a.get_modp() == b.get_modp() && a == b;
+        }
+    };
+
+    typedef std::list<std::pair<Polynomial, Factorization>> EntryList;
+
+    void insert_locked(const Polynomial& poly, const Factorization& factors);
+
+    std::size_t capacity;
+    mutable std::mutex lock;
+    // Most recently used first
+    EntryList entries;
+    std::unordered_map<Polynomial, EntryList::iterator, KeyHash, KeyEqual> index;
+    std::atomic<std::uint64_t> hits;
+    std::atomic<std::uint64_t> misses;
+};
@@ -0,0 +1,78 @@
+#include "FieldContext.h"
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+using namespace std;
+
+namespace {
+    const ull NARROW_LIMIT = 1ULL << 32;
+
+    // Recently used contexts of this thread, so lookups of the hot moduli take no lock
+    const int THREAD_CACHE_SIZE = 4;
+
+    struct ThreadCache {
+        ll modp[THREAD_CACHE_SIZE] = {0, 0, 0, 0};
+        const FieldContext* context[THREAD_CACHE_SIZE] = {nullptr, nullptr, nullptr, nullptr};
+        int next = 0;
+    };
+}
+
+FieldContext::FieldContext(ll modp) : modp(modp),
+    barrett((ull) modp < NARROW_LIMIT ? (ull) modp : 3),
+    montgomery((ull) modp < NARROW_LIMIT ? 3 : (ull) modp) {
+    if (modp <= INVERSE_TABLE_LIMIT) {
+        // inv(i) = -(p / i) * inv(p mod i), since p = (p / i) * i + p mod i
+        inverses.assign(modp, 0);
+        if (modp > 1) {
+            inverses[1] = 1;
+        }
+        for (ll i = 2; i < modp; i++) {
+            inverses[i] = (modp - (modp / i) * inverses[modp % i] % modp) % modp;
+        }
+    }
+}
+
+const FieldContext& FieldContext::get(ll modp) {
+    thread_local ThreadCache cache;
+    for (int i = 0; i < THREAD_CACHE_SIZE; i++) {
+        if (cache.modp[i] == modp && cache.context[i] != nullptr) {
+            return *cache.context[i];
+        }
+    }
+
+    static mutex lock;
+    static unordered_map<ll, unique_ptr<FieldContext>> contexts;
+    const FieldContext* context;
+    {
+        lock_guard<mutex> guard(lock);
+        auto& entry = contexts[modp];
+        if (!entry) {
+            entry.reset(new FieldContext(modp));
+        }
+        context = entry.get();
+    }
+    cache.modp[cache.next] = modp;
+    cache.context[cache.next] = context;
+    cache.next = (cache.next + 1) % THREAD_CACHE_SIZE;
+    return *context;
+}
+
+ll FieldContext::inverse(ll a) const {
+    if (!inverses.empty()) {
+        return inverses[a % modp];
+    }
+    if ((ull) modp < NARROW_LIMIT) {
+        return (ll) barrett.inv(barrett.reduce(a));
+    }
+    return (ll) montgomery.inv(montgomery.reduce(a));
+}
+
+const BarrettField& shared_barrett_field(ull modp) {
+    return FieldContext::get((ll) modp).get_barrett();
+}
+
+const MontgomeryField& shared_montgomery_field(ull modp) {
+    return FieldContext::get((ll) modp).get_montgomery();
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <vector>
+
+#include "Modular.h"
+#include "Polynomial.h"
+
+// Precomputation for one modulus, shared by every operation and thread working over it:
+// the Barrett or Montgomery constants used by with_field and, for small primes, a table of inverses.
+// Contexts are created on first use and live for the rest of the process.
+class FieldContext {
+public:
+    static const FieldContext& get(ll modp);
+
+    ll get_modp() const {
+        return modp;
+    }
+
+    ll inverse(ll a) const;
+
+    const BarrettField& get_barrett() const {
+        return barrett;
+    }
+
+    const MontgomeryField& get_montgomery() const {
+        return montgomery;
+    }
+
+    // Primes up to this bound get a full inverse table
+    static const ll INVERSE_TABLE_LIMIT = 1 << 17;
+
+private:
+    explicit FieldContext(ll modp);
+
+    ll modp;
+    // Only the one matching the size of modp is meaningful, the other keeps a placeholder modulus
+    BarrettField barrett;
+    MontgomeryField montgomery;
+    std::vector<ll> inverses;
+};
@@ -0,0 +1,374 @@
+#include "GF2.h"
+
+#include <algorithm>
+#include <cassert>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BERLEKAMP_HAS_PCLMUL_TARGET 1
+#endif
+
+using namespace std;
+
+namespace {
+    typedef std::uint64_t word;
+
+    // Carry-less product of two words as (low, high)
+    void clmul_portable(word a, word b, word& lo, word& hi) {
+        lo = 0;
+        hi = 0;
+        for (int i = 0; i < 64; i++) {
+            if ((b >> i) & 1) {
+                lo ^= a << i;
+                if (i != 0) {
+                    hi ^= a >> (64 - i);
+                }
+            }
+        }
+    }
+
+    void mul_words_portable(const word* a, size_t n, const word* b, size_t m, word* res) {
+        for (size_t i = 0; i < n; i++) {
+            if (a[i] == 0) continue;
+            for (size_t j = 0; j < m; j++) {
+                word lo, hi;
+                clmul_portable(a[i], b[j], lo, hi);
+                res[i + j] ^= lo;
+                res[i + j + 1] ^= hi;
+            }
+        }
+    }
+
+#ifdef BERLEKAMP_HAS_PCLMUL_TARGET
+    __attribute__((target("pclmul,sse2")))
+    void mul_words_pclmul(const word* a, size_t n, const word* b, size_t m, word* res) {
+        for (size_t i = 0; i < n; i++) {
+            if (a[i] == 0) continue;
+            __m128i x = _mm_cvtsi64_si128((long long) a[i]);
+            for (size_t j = 0; j < m; j++) {
+                __m128i r = _mm_clmulepi64_si128(x, _mm_cvtsi64_si128((long long) b[j]), 0);
+                res[i + j] ^= (word) _mm_cvtsi128_si64(r);
+                res[i + j + 1] ^= (word) _mm_cvtsi128_si64(_mm_srli_si128(r, 8));
+            }
+        }
+    }
+
+    bool has_pclmul() {
+        static const bool supported = __builtin_cpu_supports("pclmul");
+        return supported;
+    }
+#endif
+
+    void mul_words(const word* a, size_t n, const word* b, size_t m, word* res) {
+#ifdef BERLEKAMP_HAS_PCLMUL_TARGET
+        if (has_pclmul()) {
+            mul_words_pclmul(a, n, b, m, res);
+            return;
+        }
+#endif
+        mul_words_portable(a, n, b, m, res);
+    }
+
+    // Spreads the 32 low bits of x to the even bit positions
+    word spread_bits(word x) {
+        x &= 0xFFFFFFFFULL;
+        x = (x | (x << 16)) & 0x0000FFFF0000FFFFULL;
+        x = (x | (x << 8)) & 0x00FF00FF00FF00FFULL;
+        x = (x | (x << 4)) & 0x0F0F0F0F0F0F0F0FULL;
+        x = (x | (x << 2)) & 0x3333333333333333ULL;
+        x = (x | (x << 1)) & 0x5555555555555555ULL;
+        return x;
+    }
+
+    // Gathers the even bits of x into the 32 low bits
+    word gather_bits(word x) {
+        x &= 0x5555555555555555ULL;
+        x = (x | (x >> 1)) & 0x3333333333333333ULL;
+        x = (x | (x >> 2)) & 0x0F0F0F0F0F0F0F0FULL;
+        x = (x | (x >> 4)) & 0x00FF00FF00FF00FFULL;
+        x = (x | (x >> 8)) & 0x0000FFFF0000FFFFULL;
+        x = (x | (x >> 16)) & 0x00000000FFFFFFFFULL;
+        return x;
+    }
+}
+
+GF2Polynomial::GF2Polynomial(const Polynomial& poly) {
+    assert(poly.get_modp() == 2);
+    int n = poly.get_degree() + 1;
+    auto coeffs = poly.get_coeffs(n);
+    words.assign((n + 63) / 64, 0);
+    for (int i = 0; i < n; i++) {
+        if (coeffs[i] & 1) {
+            words[i / 64] |= word(1) << (i % 64);
+        }
+    }
+    prune();
+}
+
+GF2Polynomial GF2Polynomial::get_one() {
+    return GF2Polynomial(vector<word>{1});
+}
+
+Polynomial GF2Polynomial::to_polynomial() const {
+    vector<ll> coeffs(words.size() * 64, 0);
+    for (size_t i = 0; i < coeffs.size(); i++) {
+        coeffs[i] = (words[i / 64] >> (i % 64)) & 1;
+    }
+    return Polynomial(coeffs, 2);
+}
+
+void GF2Polynomial::prune() {
+    while (!words.empty() && words.back() == 0) {
+        words.pop_back();
+    }
+}
+
+int GF2Polynomial::get_degree() const {
+    if (words.empty()) return 0;
+    return (int) (words.size() - 1) * 64 + 63 - __builtin_clzll(words.back());
+}
+
+bool GF2Polynomial::get(int i) const {
+    if (i / 64 >= (int) words.size()) {
+        return false;
+    }
+    return (words[i / 64] >> (i % 64)) & 1;
+}
+
+void GF2Polynomial::flip(int i) {
+    if (i / 64 >= (int) words.size()) {
+        words.resize(i / 64 + 1, 0);
+    }
+    words[i / 64] ^= word(1) << (i % 64);
+    prune();
+}
+
+GF2Polynomial GF2Polynomial::diff() const {
+    // d/dx x^i = i x^(i-1) keeps only the odd powers
+    vector<word> res(words.size(), 0);
+    for (size_t i = 0; i < words.size(); i++) {
+        word odd = words[i] & 0xAAAAAAAAAAAAAAAAULL;
+        res[i] |= odd >> 1;
+    }
+    return GF2Polynomial(res);
+}
+
+GF2Polynomial GF2Polynomial::get_sqrt() const {
+    // Frobenius is additive, so sqrt(sum x^(2i)) = sum x^i; odd powers are ignored
+    vector<word> res((words.size() + 1) / 2, 0);
+    for (size_t i = 0; i < words.size(); i++) {
+        res[i / 2] |= gather_bits(words[i]) << (32 * (i % 2));
+    }
+    return GF2Polynomial(res);
+}
+
+GF2Polynomial GF2Polynomial::square() const {
+    vector<word> res(words.size() * 2, 0);
+    for (size_t i = 0; i < words.size(); i++) {
+        res[2 * i] = spread_bits(words[i]);
+        res[2 * i + 1] = spread_bits(words[i] >> 32);
+    }
+    return GF2Polynomial(res);
+}
+
+GF2Polynomial GF2Polynomial::add(const GF2Polynomial& a, const GF2Polynomial& b) {
+    const auto& lng = a.words.size() >= b.words.size() ? a.words : b.words;
+    const auto& sht = a.words.size() >= b.words.size() ? b.words : a.words;
+    vector<word> res = lng;
+    for (size_t i = 0; i < sht.size(); i++) {
+        res[i] ^= sht[i];
+    }
+    return GF2Polynomial(res);
+}
+
+GF2Polynomial GF2Polynomial::mul(const GF2Polynomial& a, const GF2Polynomial& b) {
+    if (a.is_zero() || b.is_zero()) {
+        return GF2Polynomial();
+    }
+    vector<word> res(a.words.size() + b.words.size(), 0);
+    mul_words(a.words.data(), a.words.size(), b.words.data(), b.words.size(), res.data());
+    return GF2Polynomial(res);
+}
+
+pair<GF2Polynomial, GF2Polynomial> GF2Polynomial::divmod(const GF2Polynomial& a, const GF2Polynomial& b) {
+    assert(!b.is_zero());
+    int da = a.get_degree(), db = b.get_degree();
+    if (a.is_zero() || da < db) {
+        return { GF2Polynomial(), a };
+    }
+    vector<word> r = a.words;
+    vector<word> q((da - db) / 64 + 1, 0);
+    size_t bw = b.words.size();
+    for (int i = da; i >= db; i--) {
+        if (!((r[i / 64] >> (i % 64)) & 1)) continue;
+        int shift = i - db;
+        q[shift / 64] |= word(1) << (shift % 64);
+        int wo = shift / 64, bit = shift % 64;
+        // r ^= b << shift, one or two words per word of b
+        for (size_t k = 0; k < bw; k++) {
+            r[k + wo] ^= b.words[k] << bit;
+            if (bit != 0 && k + wo + 1 < r.size()) {
+                r[k + wo + 1] ^= b.words[k] >> (64 - bit);
+            }
+        }
+    }
+    return { GF2Polynomial(q), GF2Polynomial(r) };
+}
+
+GF2Polynomial GF2Polynomial::gcd(GF2Polynomial a, GF2Polynomial b) {
+    while (!b.is_zero()) {
+        auto r = divmod(a, b).second;
+        a = std::move(b);
+        b = std::move(r);
+    }
+    return a;
+}
+
+GF2Matrix::GF2Matrix(int size) : size(size), stride((size + 63) / 64), entries((size_t) size * ((size + 63) / 64), 0) {
+}
+
+void GF2Matrix::set(int row, int column, bool value) {
+    word& w = entries[row * stride + column / 64];
+    word bit = word(1) << (column % 64);
+    w = value ? (w | bit) : (w & ~bit);
+}
+
+void GF2Matrix::swap_rows(int row1, int row2) {
+    if (row1 == row2) return;
+    swap_ranges(entries.begin() + row1 * stride, entries.begin() + (row1 + 1) * stride, entries.begin() + row2 * stride);
+}
+
+void GF2Matrix::xor_rows(int subfrom, int sub) {
+    word* dst = &entries[subfrom * stride];
+    const word* src = &entries[sub * stride];
+    for (int i = 0; i < stride; i++) {
+        dst[i] ^= src[i];
+    }
+}
+
+void GF2Matrix::row_echelon_form() {
+    int r = 0;
+    for (int lead = 0; lead < size && r < size; lead++) {
+        int i = r;
+        while (i < size && !get(i, lead)) {
+            i++;
+        }
+        if (i == size) {
+            continue;
+        }
+        swap_rows(i, r);
+        for (i = 0; i < size; i++) {
+            if (i != r && get(i, lead)) {
+                xor_rows(i, r);
+            }
+        }
+        r++;
+    }
+}
+
+namespace {
+    vector<pair<GF2Polynomial, int>> squarefree_decompose_gf2(const GF2Polynomial& poly) {
+        vector<pair<GF2Polynomial, int>> result;
+        GF2Polynomial f = poly;
+        GF2Polynomial g;
+        int m = 1;
+        do {
+            g = GF2Polynomial::gcd(f, f.diff());
+            auto t = f / g;
+            int i = 1;
+            while (!t.is_one()) {
+                auto tt = GF2Polynomial::gcd(t, g);
+                auto qq = t / tt;
+                if (!qq.is_one()) {
+                    result.emplace_back(qq, i * m);
+                }
+                t = tt;
+                g = g / tt;
+                i++;
+            }
+            if (!g.is_one()) {
+                f = g.get_sqrt();
+                m *= 2;
+            }
+        } while (!g.is_one());
+        return result;
+    }
+
+    // Null space of (Q - I)^T where row i of Q is x^(2i) mod poly
+    vector<GF2Polynomial> berlekamp_basis_gf2(const GF2Polynomial& poly) {
+        int n = poly.get_degree();
+        GF2Matrix a(n);
+        GF2Polynomial row = GF2Polynomial::get_one();
+        auto x2 = GF2Polynomial(vector<word>{4});
+        for (int i = 0; i < n; i++) {
+            if (i > 0) {
+                row = (row * x2) % poly;
+            }
+            for (int j = 0; j < n; j++) {
+                a.set(j, i, row.get(j) != (i == j));
+            }
+        }
+        a.row_echelon_form();
+
+        vector<int> pivot_column;
+        vector<bool> is_pivot(n, false);
+        for (int r = 0; r < n; r++) {
+            int c = 0;
+            while (c < n && !a.get(r, c)) {
+                c++;
+            }
+            if (c == n) break;
+            pivot_column.push_back(c);
+            is_pivot[c] = true;
+        }
+
+        vector<GF2Polynomial> basis;
+        for (int i = 0; i < n; i++) {
+            if (is_pivot[i]) continue;
+            vector<word> v((n + 63) / 64, 0);
+            v[i / 64] |= word(1) << (i % 64);
+            for (size_t r = 0; r < pivot_column.size(); r++) {
+                if (a.get(r, i)) {
+                    v[pivot_column[r] / 64] |= word(1) << (pivot_column[r] % 64);
+                }
+            }
+            basis.emplace_back(v);
+        }
+        return basis;
+    }
+
+    vector<GF2Polynomial> factor_gf2(const GF2Polynomial& poly) {
+        if (poly.get_degree() <= 1) {
+            return {poly};
+        }
+        auto basis = berlekamp_basis_gf2(poly);
+        vector<GF2Polynomial> factors{poly};
+        size_t k = 1;
+        auto one = GF2Polynomial::get_one();
+        while (factors.size() < basis.size()) {
+            vector<GF2Polynomial> newfactors;
+            for (int s = 0; s < 2; s++) {
+                auto v = s ? basis[k] + one : basis[k];
+                for (const auto& w : factors) {
+                    auto ww = GF2Polynomial::gcd(w, v);
+                    if (!ww.is_one()) {
+                        newfactors.push_back(ww);
+                    }
+                }
+            }
+            swap(factors, newfactors);
+            k++;
+        }
+        return factors;
+    }
+}
+
+vector<pair<Polynomial, int>> berlekamp_factor_gf2(const Polynomial& poly) {
+    vector<pair<Polynomial, int>> result;
+    for (const auto& part : squarefree_decompose_gf2(GF2Polynomial(poly))) {
+        for (const auto& f : factor_gf2(part.first)) {
+            result.emplace_back(f.to_polynomial(), part.second);
+        }
+    }
+    return result;
+}
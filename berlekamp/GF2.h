@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "Polynomial.h"
+
+// Polynomial over GF(2) packed 64 coefficients per word, bit i of words[i / 64] is the coefficient of x^i.
+// Multiplication uses carry-less multiply (PCLMULQDQ when the CPU has it, a portable shift-and-xor otherwise),
+// addition is a word-wide XOR.
+class GF2Polynomial {
+public:
+    GF2Polynomial() {}
+
+    explicit GF2Polynomial(const Polynomial& poly);
+
+    explicit GF2Polynomial(std::vector<std::uint64_t> words) : words(std::move(words)) {
+        prune();
+    }
+
+    static GF2Polynomial get_one();
+
+    Polynomial to_polynomial() const;
+
+    int get_degree() const;
+
+    bool get(int i) const;
+
+    void flip(int i);
+
+    bool is_zero() const {
+        return words.empty();
+    }
+
+    bool is_one() const {
+        return words.size() == 1 && words[0] == 1;
+    }
+
+    GF2Polynomial diff() const;
+
+    GF2Polynomial get_sqrt() const;
+
+    GF2Polynomial square() const;
+
+    static GF2Polynomial add(const GF2Polynomial& a, const GF2Polynomial& b);
+
+    static GF2Polynomial mul(const GF2Polynomial& a, const GF2Polynomial& b);
+
+    static std::pair<GF2Polynomial, GF2Polynomial> divmod(const GF2Polynomial& a, const GF2Polynomial& b);
+
+    static GF2Polynomial gcd(GF2Polynomial a, GF2Polynomial b);
+
+    GF2Polynomial operator+(const GF2Polynomial &rhs) const {
+        return add(*this, rhs);
+    }
+
+    GF2Polynomial operator*(const GF2Polynomial &rhs) const {
+        return mul(*this, rhs);
+    }
+
+    GF2Polynomial operator/(const GF2Polynomial &rhs) const {
+        return divmod(*this, rhs).first;
+    }
+
+    GF2Polynomial operator%(const GF2Polynomial &rhs) const {
+        return divmod(*this, rhs).second;
+    }
+
+    friend bool operator== (const GF2Polynomial &poly1, const GF2Polynomial &poly2) {
+        return poly1.words == poly2.words;
+    }
+
+private:
+    std::vector<std::uint64_t> words;
+
+    void prune();
+};
+
+// Square matrix over GF(2) with every row stored as a bit-packed span of words,
+// so row operations of the elimination are word-wide XORs
+class GF2Matrix {
+public:
+    explicit GF2Matrix(int size);
+
+    bool get(int row, int column) const {
+        return (entries[row * stride + column / 64] >> (column % 64)) & 1;
+    }
+
+    void set(int row, int column, bool value);
+
+    int get_size() const {
+        return size;
+    }
+
+    void swap_rows(int row1, int row2);
+
+    // Row subfrom ^= row sub
+    void xor_rows(int subfrom, int sub);
+
+    void row_echelon_form();
+
+private:
+    int size;
+    int stride;
+    std::vector<std::uint64_t> entries;
+};
+
+// Berlekamp factorization specialized to GF(2), berlekamp_factor dispatches here when modp == 2
+std::vector<std::pair<Polynomial, int>> berlekamp_factor_gf2(const Polynomial& poly);
@@ -0,0 +1,125 @@
+#include "KaltofenShoup.h"
+#include "Composition.h"
+#include "PolynomialModulus.h"
+
+#include <cassert>
+
+using namespace std;
+
+vector<pair<Polynomial, int>> distinct_degree_decompose_bsgs(const Polynomial& poly) {
+    ll modp = poly.get_modp();
+    vector<pair<Polynomial, int>> result;
+    Polynomial f = poly.normalize();
+    int n = f.get_degree();
+    if (n <= 0) {
+        return result;
+    }
+    int l = 1;
+    while (2 * l * l < n) {
+        l++;
+    }
+    // Every power is taken modulo the input, rest only loses the factors found so far
+    PolynomialModulus modulus(f);
+    FrobeniusCache frobenius(modulus);
+    vector<Polynomial> baby;
+    for (int i = 0; i < l; i++) {
+        baby.push_back(frobenius.power(i));
+    }
+    ModularComposition giant_step(frobenius.power(l), modulus);
+    Polynomial rest = f;
+    Polynomial giant = frobenius.power(l);
+    // Once deg rest < 2 (lj + 1) a reducible rest would have a factor of degree <= lj, which is gone already
+    for (int j = 1; rest.get_degree() >= 2 * (l * (j - 1) + 1); j++) {
+        if (j > 1) {
+            giant = giant_step.compose(giant);
+        }
+        Polynomial product = Polynomial::get_one(modp);
+        for (int i = 0; i < l; i++) {
+            product.mulmod_inplace(giant - baby[i], modulus);
+        }
+        auto block = Polynomial::gcd(rest, product);
+        if (block.is_one()) {
+            continue;
+        }
+        block = block.normalize();
+        rest = Polynomial::div(rest, block);
+        for (int i = l - 1; i >= 0 && block.get_degree() > 0; i--) {
+            auto g = Polynomial::gcd(block, giant - baby[i]);
+            if (!g.is_one()) {
+                g = g.normalize();
+                result.emplace_back(g, l * j - i);
+                block = Polynomial::div(block, g);
+            }
+        }
+    }
+    if (rest.get_degree() > 0) {
+        result.emplace_back(rest.normalize(), rest.get_degree());
+    }
+    return result;
+}
+
+namespace {
+    // xp is x^p modulo f or a multiple of f
+    void split_equal_degree(const Polynomial& f, int degree, const Polynomial& xp, mt19937_64& rng,
+                            vector<Polynomial>& factors) {
+        int n = f.get_degree();
+        if (n == degree) {
+            factors.push_back(f);
+            return;
+        }
+        ll modp = f.get_modp();
+        PolynomialModulus modulus(f);
+        FrobeniusCache frobenius(modulus, xp);
+        uniform_int_distribution<ll> dist(0, modp - 1);
+        auto one = Polynomial::get_one(modp);
+        while (true) {
+            vector<ll> c(n);
+            for (auto& x : c) {
+                x = dist(rng);
+            }
+            Polynomial a(move(c), modp);
+            if (a.get_degree() <= 0) {
+                continue;
+            }
+            Polynomial b;
+            if (modp == 2) {
+                b = a;
+                for (int i = 1; i < degree; i++) {
+                    a = frobenius.apply(a);
+                    b += a;
+                }
+            } else {
+                a = Polynomial::powmod(a, (modp - 1) / 2, modulus);
+                b = a;
+                for (int i = 1; i < degree; i++) {
+                    a = frobenius.apply(a);
+                    b.mulmod_inplace(a, modulus);
+                }
+                b -= one;
+            }
+            auto g = Polynomial::gcd(f, b);
+            if (g.get_degree() > 0 && g.get_degree() < n) {
+                g = g.normalize();
+                auto cofactor = Polynomial::div(f, g).normalize();
+                split_equal_degree(g, degree, frobenius.power(1), rng, factors);
+                split_equal_degree(cofactor, degree, frobenius.power(1), rng, factors);
+                return;
+            }
+        }
+    }
+}
+
+vector<Polynomial> equal_degree_split(const Polynomial& poly, int degree, mt19937_64& rng) {
+    assert(degree > 0 && poly.get_degree() % degree == 0);
+    vector<Polynomial> factors;
+    Polynomial f = poly.normalize();
+    if (f.get_degree() == degree) {
+        factors.push_back(f);
+        return factors;
+    }
+    ll modp = f.get_modp();
+    PolynomialModulus modulus(f);
+    auto xp = Polynomial::powmod(Polynomial(vector<ll>{0, 1}, modp), modp, modulus);
+    split_equal_degree(f, degree, xp, rng, factors);
+    return factors;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "Polynomial.h"
+
+// Kaltofen-Shoup distinct-degree factorization of a squarefree polynomial, the same pairs (g, i) as
+// distinct_degree_decompose. With l = ceil(sqrt(n / 2)) the baby steps x^(p^i), i < l, come from a FrobeniusCache
+// and the giant steps H_j = x^(p^(lj)) from composing with x^(p^l). gcd(f, prod_i (H_j - x^(p^i))) collects the
+// factors of degree in (l(j - 1), lj], one gcd per baby step then tells them apart.
+// O(sqrt(n)) compositions and O(n) multiplications mod f replace the n / 2 powmods and gcds of the plain loop.
+std::vector<std::pair<Polynomial, int>> distinct_degree_decompose_bsgs(const Polynomial& poly);
+
+// Cantor-Zassenhaus splitting of a squarefree polynomial whose irreducible factors all have the given degree d.
+// For odd p, a^((p^d - 1) / 2) is 0 or +-1 modulo every factor; it is the product of the d Frobenius images of
+// a^((p - 1) / 2). For p = 2 the trace a + a^2 + ... + a^(2^(d-1)) takes its place. The factors come out monic.
+std::vector<Polynomial> equal_degree_split(const Polynomial& poly, int degree, std::mt19937_64& rng);
@@ -1,17 +1,63 @@
 #include "Matrix.h"
+#include "Modular.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
 #include <iostream>
 #include <utility>
 
-Matrix::Matrix(int si, ll modp) : size(si), entries(si*si), modp(std::move(modp)) {
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BERLEKAMP_HAS_AVX_TARGET 1
+#endif
+
+Matrix::Matrix(int si, ll modp) : size(si), modp(modp), width(entry_width(modp)),
+    entries((size_t) si * si * width) {
+}
+
+int Matrix::entry_width(ll modp) {
+    if (modp <= (1LL << 8)) {
+        return 1;
+    }
+    if (modp <= (1LL << 16)) {
+        return 2;
+    }
+    if (modp <= (1LL << 32)) {
+        return 4;
+    }
+    return 8;
 }
 
 void Matrix::set(int row, int column, const ll& value)
 {
-    entries[column + size * row] = value;
+    size_t i = column + (size_t) size * row;
+    switch (width) {
+        case 1:
+            data<std::uint8_t>()[i] = (std::uint8_t) value;
+            break;
+        case 2:
+            data<std::uint16_t>()[i] = (std::uint16_t) value;
+            break;
+        case 4:
+            data<std::uint32_t>()[i] = (std::uint32_t) value;
+            break;
+        default:
+            data<ll>()[i] = value;
+    }
 }
 
 ll Matrix::get(int row, int column) const {
-    return entries[column + size * row];
+    size_t i = column + (size_t) size * row;
+    switch (width) {
+        case 1:
+            return data<std::uint8_t>()[i];
+        case 2:
+            return data<std::uint16_t>()[i];
+        case 4:
+            return data<std::uint32_t>()[i];
+        default:
+            return data<ll>()[i];
+    }
 }
 
 int Matrix::get_size() const {
@@ -33,22 +79,26 @@ Matrix Matrix::identity(int size, ll modp) {
 Matrix Matrix::operator+(const Matrix& rhs) const {
     int si = std::min(get_size(), rhs.get_size());
     Matrix m{si, modp};
-    for (int row = 0; row < si; ++row) {
-        for (int col = 0; col < si; ++col) {
-            m.set(row, col, (get(row, col) + rhs.get(row, col) + modp) % modp);
+    with_field(modp, [&](const auto& field) {
+        for (int row = 0; row < si; ++row) {
+            for (int col = 0; col < si; ++col) {
+                m.set(row, col, field.add(get(row, col), rhs.get(row, col)));
+            }
         }
-    }
+    });
     return m;
 }
 
 Matrix Matrix::operator-(const Matrix& rhs)const {
     int si = std::min(get_size(), rhs.get_size());
     Matrix m{si, modp};
-    for (int row = 0; row < si; ++row) {
-        for (int col = 0; col < si; ++col) {
-            m.set(row, col, (modp + modp + get(row, col) - rhs.get(row, col)) % modp);
+    with_field(modp, [&](const auto& field) {
+        for (int row = 0; row < si; ++row) {
+            for (int col = 0; col < si; ++col) {
+                m.set(row, col, field.sub(get(row, col), rhs.get(row, col)));
+            }
         }
-    }
+    });
     return m;
 }
 
@@ -65,18 +115,21 @@ Matrix Matrix::get_transpose()const
 
 void Matrix::swap_rows(int row1, int row2)
 {
-    for (int col = 0; col < get_size(); ++col) {
-        ll a = get(row1, col);
-        ll b = get(row2, col);
-        set(row1, col, b);
-        set(row2, col, a);
+    if (row1 == row2) {
+        return;
     }
+    size_t row_bytes = (size_t) size * width;
+    std::swap_ranges(entries.begin() + row_bytes * row1, entries.begin() + row_bytes * (row1 + 1),
+                     entries.begin() + row_bytes * row2);
 }
 
 void Matrix::sub_rows(int subfrom, int sub, ll multiplier) {
-    for (int col = 0; col < get_size(); ++col) {
-        set(subfrom, col, (get(subfrom, col) - (get(sub, col) * multiplier) % modp + modp + modp) % modp);
-    }
+    with_field(modp, [&](const auto& field) {
+        ull neg = field.neg(multiplier);
+        for (int col = 0; col < get_size(); ++col) {
+            set(subfrom, col, field.mul_add(get(subfrom, col), neg, get(sub, col)));
+        }
+    });
 }
 
 std::ostream &operator<<(std::ostream &o, const Matrix &m) {
@@ -91,9 +144,345 @@ std::ostream &operator<<(std::ostream &o, const Matrix &m) {
 
 void Matrix::divide_row(int r, const ll& x) {
     ll inv = Polynomial::inverse(x, modp);
-    for (int col = 0; col < get_size(); ++col) {
-        auto value = get(r, col);
-        value = (value * inv) % modp;
-        set(r, col, value);
+    with_field(modp, [&](const auto& field) {
+        for (int col = 0; col < get_size(); ++col) {
+            set(r, col, field.mul(get(r, col), inv));
+        }
+    });
+}
+
+namespace {
+    typedef unsigned long long ull;
+
+    // Columns are updated in blocks of this many entries, so the block of the pivot row
+    // stays in L1 while it is applied to every other row
+    const int ELIMINATION_BLOCK = 1024;
+
+    // Smaller matrices are eliminated on the calling thread
+    const int PARALLEL_ELIMINATION_MIN = 256;
+
+    const int COMPACT_ELIMINATION_DEFAULT = 640;
+
+    // Rows per task, large enough to amortize scheduling and small enough to balance the workers
+    size_t rows_per_task(ThreadPool* pool, int n) {
+        if (pool == nullptr || n < PARALLEL_ELIMINATION_MIN) {
+            return n;
+        }
+        return std::max<size_t>(16, n / (4 * pool->get_size()));
+    }
+
+    // dst[i] += m * src[i] for m, src[i] < 2^32, the caller guarantees the sums fit into 64 bits
+    void axpy_scalar(ull* dst, const ull* src, ull m, int n) {
+        for (int i = 0; i < n; i++) {
+            dst[i] += m * src[i];
+        }
+    }
+
+#ifdef BERLEKAMP_HAS_AVX_TARGET
+    // vpmuludq multiplies the low 32 bits of each 64-bit lane, which is exact for m, src[i] < 2^32
+    __attribute__((target("avx2")))
+    void axpy_avx2(ull* dst, const ull* src, ull m, int n) {
+        __m256i vm = _mm256_set1_epi64x((long long) m);
+        int i = 0;
+        for (; i + 4 <= n; i += 4) {
+            __m256i s = _mm256_loadu_si256((const __m256i*) (src + i));
+            __m256i d = _mm256_loadu_si256((const __m256i*) (dst + i));
+            _mm256_storeu_si256((__m256i*) (dst + i), _mm256_add_epi64(d, _mm256_mul_epu32(s, vm)));
+        }
+        axpy_scalar(dst + i, src + i, m, n - i);
+    }
+
+    __attribute__((target("avx512f")))
+    void axpy_avx512(ull* dst, const ull* src, ull m, int n) {
+        __m512i vm = _mm512_set1_epi64((long long) m);
+        int i = 0;
+        for (; i + 8 <= n; i += 8) {
+            __m512i s = _mm512_loadu_si512((const void*) (src + i));
+            __m512i d = _mm512_loadu_si512((const void*) (dst + i));
+            _mm512_storeu_si512((void*) (dst + i), _mm512_add_epi64(d, _mm512_mul_epu32(s, vm)));
+        }
+        axpy_scalar(dst + i, src + i, m, n - i);
+    }
+#endif
+
+    typedef void (*axpy_kernel)(ull*, const ull*, ull, int);
+
+    axpy_kernel select_axpy() {
+#ifdef BERLEKAMP_HAS_AVX_TARGET
+        if (__builtin_cpu_supports("avx512f")) {
+            return axpy_avx512;
+        }
+        if (__builtin_cpu_supports("avx2")) {
+            return axpy_avx2;
+        }
+#endif
+        return axpy_scalar;
+    }
+
+    // Gauss-Jordan elimination with deferred reduction. Entries of non-pivot rows are kept
+    // unreduced while up to lazy_limit updates of at most (p-1)^2 each still fit into 64 bits.
+    // Columns left of the pivot are zero modulo p in the pivot row and are never touched.
+    template <class Field>
+    void eliminate(const Field& field, ull* a, int n, ull lazy_limit, ThreadPool* pool) {
+        static const axpy_kernel axpy = select_axpy();
+        std::vector<ull> pending(n, 0);
+        std::vector<ull> multipliers(n, 0);
+        auto reduce_row = [&](int row, int from) {
+            ull* x = a + (size_t) row * n;
+            for (int c = from; c < n; c++) {
+                x[c] = field.reduce(x[c]);
+            }
+            pending[row] = 0;
+        };
+
+        int r = 0;
+        for (int lead = 0; lead < n && r < n; lead++) {
+            int i = r;
+            while (i < n && field.reduce(a[(size_t) i * n + lead]) == 0) {
+                i++;
+            }
+            if (i == n) {
+                continue;
+            }
+            if (i != r) {
+                std::swap_ranges(a + (size_t) i * n + lead, a + (size_t) (i + 1) * n, a + (size_t) r * n + lead);
+                std::swap(pending[i], pending[r]);
+            }
+            reduce_row(r, lead);
+            ull* pivot = a + (size_t) r * n;
+            ull inv = field.inv(pivot[lead]);
+            for (int c = lead; c < n; c++) {
+                pivot[c] = field.mul(pivot[c], inv);
+            }
+
+            for (i = 0; i < n; i++) {
+                multipliers[i] = 0;
+                if (i == r) continue;
+                ull m = field.reduce(a[(size_t) i * n + lead]);
+                if (m == 0) {
+                    a[(size_t) i * n + lead] = 0;
+                    continue;
+                }
+                if (pending[i] >= lazy_limit) {
+                    reduce_row(i, lead);
+                }
+                multipliers[i] = field.neg(m);
+                pending[i]++;
+            }
+            size_t grain = rows_per_task(pool, n);
+            parallel_for(pool, (n + grain - 1) / grain, [&](size_t task) {
+                int first = (int) (task * grain), last = (int) std::min<size_t>(n, (task + 1) * grain);
+                for (int from = lead; from < n; from += ELIMINATION_BLOCK) {
+                    int len = std::min(ELIMINATION_BLOCK, n - from);
+                    for (int row = first; row < last; row++) {
+                        if (multipliers[row] != 0) {
+                            axpy(a + (size_t) row * n + from, pivot + from, multipliers[row], len);
+                        }
+                    }
+                }
+            });
+            r++;
+        }
+        for (size_t i = 0; i < (size_t) n * n; i++) {
+            a[i] = field.reduce(a[i]);
+        }
+    }
+
+    // Columns per panel of eliminate_panels
+    const int PANEL_WIDTH = 64;
+
+    // Gauss-Jordan elimination on narrow entries, a panel of up to PANEL_WIDTH pivot columns at a time.
+    // Every row operation of a panel adds multiples of the panel's pivot rows, so after the panel each row is
+    // its old self (or nothing, for the pivot rows) plus a combination of the pivot rows as they were before it.
+    // Only the panel's own columns are updated step by step, which also tracks the combination coefficients;
+    // the columns right of the panel are then updated once per panel, summing up to `panel` products of at most
+    // (p-1)^2 in 64 bits with the SIMD axpy and reducing each entry once. The entries are never widened in place.
+    template <class T, class Field>
+    void eliminate_panels(const Field& field, T* a, int n, int panel, ThreadPool* pool) {
+        static const axpy_kernel axpy = select_axpy();
+        std::vector<ull> coef((size_t) n * panel);
+        int r = 0;
+        for (int lead = 0; lead < n && r < n; ) {
+            int r0 = r;
+            int window_end = std::min(n, lead + panel);
+            std::fill(coef.begin(), coef.end(), 0);
+            int k = 0;
+            for (int col = lead; col < window_end && r < n; col++) {
+                int i = r;
+                while (i < n && a[(size_t) i * n + col] == 0) {
+                    i++;
+                }
+                if (i == n) {
+                    continue;
+                }
+                // Rows from r on are zero left of col, their trailing parts move along with them
+                if (i != r) {
+                    std::swap_ranges(a + (size_t) i * n + col, a + (size_t) (i + 1) * n, a + (size_t) r * n + col);
+                    std::swap_ranges(coef.begin() + (size_t) i * panel, coef.begin() + (size_t) (i + 1) * panel,
+                                     coef.begin() + (size_t) r * panel);
+                }
+                T* pivot = a + (size_t) r * n;
+                ull* pivot_coef = coef.data() + (size_t) r * panel;
+                pivot_coef[k] = 1;
+                ull inv = field.inv(pivot[col]);
+                for (int c = col; c < window_end; c++) {
+                    pivot[c] = (T) field.mul(pivot[c], inv);
+                }
+                for (int j = 0; j <= k; j++) {
+                    pivot_coef[j] = field.mul(pivot_coef[j], inv);
+                }
+                for (i = 0; i < n; i++) {
+                    T* x = a + (size_t) i * n;
+                    if (i == r || x[col] == 0) continue;
+                    ull m = field.neg(x[col]);
+                    for (int c = col; c < window_end; c++) {
+                        x[c] = (T) field.mul_add(x[c], m, pivot[c]);
+                    }
+                    ull* row_coef = coef.data() + (size_t) i * panel;
+                    for (int j = 0; j <= k; j++) {
+                        row_coef[j] = field.mul_add(row_coef[j], m, pivot_coef[j]);
+                    }
+                }
+                k++;
+                r++;
+            }
+
+            std::vector<ull> snapshot((size_t) k * ELIMINATION_BLOCK);
+            for (int from = window_end; from < n && k > 0; from += ELIMINATION_BLOCK) {
+                int len = std::min(ELIMINATION_BLOCK, n - from);
+                for (int j = 0; j < k; j++) {
+                    const T* src = a + (size_t) (r0 + j) * n + from;
+                    std::copy(src, src + len, snapshot.begin() + (size_t) j * ELIMINATION_BLOCK);
+                }
+                size_t grain = rows_per_task(pool, n);
+                parallel_for(pool, (n + grain - 1) / grain, [&](size_t task) {
+                    std::vector<ull> acc(len);
+                    int last = (int) std::min<size_t>(n, (task + 1) * grain);
+                    for (int row = (int) (task * grain); row < last; row++) {
+                        const ull* row_coef = coef.data() + (size_t) row * panel;
+                        bool is_pivot = row >= r0 && row < r0 + k;
+                        if (!is_pivot && std::all_of(row_coef, row_coef + k, [](ull c) { return c == 0; })) {
+                            continue;
+                        }
+                        T* x = a + (size_t) row * n + from;
+                        for (int c = 0; c < len; c++) {
+                            acc[c] = is_pivot ? 0 : x[c];
+                        }
+                        for (int j = 0; j < k; j++) {
+                            if (row_coef[j] != 0) {
+                                axpy(acc.data(), snapshot.data() + (size_t) j * ELIMINATION_BLOCK, row_coef[j], len);
+                            }
+                        }
+                        for (int c = 0; c < len; c++) {
+                            x[c] = (T) field.reduce(acc[c]);
+                        }
+                    }
+                });
+            }
+            lead = window_end;
+        }
+    }
+
+    // Wide moduli leave no headroom for deferred sums, every update is reduced right away
+    template <class Field>
+    void eliminate_wide(const Field& field, ull* a, int n, ThreadPool* pool) {
+        int r = 0;
+        for (int lead = 0; lead < n && r < n; lead++) {
+            int i = r;
+            while (i < n && a[(size_t) i * n + lead] == 0) {
+                i++;
+            }
+            if (i == n) {
+                continue;
+            }
+            if (i != r) {
+                std::swap_ranges(a + (size_t) i * n + lead, a + (size_t) (i + 1) * n, a + (size_t) r * n + lead);
+            }
+            ull* pivot = a + (size_t) r * n;
+            ull inv = field.inv(pivot[lead]);
+            for (int c = lead; c < n; c++) {
+                pivot[c] = field.mul(pivot[c], inv);
+            }
+            size_t grain = rows_per_task(pool, n);
+            parallel_for(pool, (n + grain - 1) / grain, [&](size_t task) {
+                int last = (int) std::min<size_t>(n, (task + 1) * grain);
+                for (int row = (int) (task * grain); row < last; row++) {
+                    ull* x = a + (size_t) row * n;
+                    if (row == r || x[lead] == 0) continue;
+                    ull m = field.neg(x[lead]);
+                    for (int c = lead; c < n; c++) {
+                        x[c] = field.mul_add(x[c], m, pivot[c]);
+                    }
+                }
+            });
+            r++;
+        }
+    }
+
+    template <class T>
+    void eliminate_compact(T* a, int n, ll modp, ThreadPool* pool) {
+        with_field(modp, [&](const auto& field) {
+            ull p1 = field.modulus() - 1;
+            ull limit = (~0ULL - p1) / std::max(p1 * p1, 1ULL);
+            eliminate_panels(field, a, n, (int) std::min<ull>(PANEL_WIDTH, limit), pool);
+        });
+    }
+
+    // Runs the deferred-reduction kernel on a 64-bit copy of narrow entries
+    template <class T>
+    void eliminate_widened(T* a, int n, ll modp, ThreadPool* pool) {
+        std::vector<ull> wide(a, a + (size_t) n * n);
+        with_field(modp, [&](const auto& field) {
+            ull p1 = field.modulus() - 1;
+            eliminate(field, wide.data(), n, (~0ULL - p1) / std::max(p1 * p1, 1ULL), pool);
+        });
+        std::copy(wide.begin(), wide.end(), a);
+    }
+
+    // Measured crossover: below it the 64-bit working copy fits the caches well enough for the deferred
+    // reductions to win, above it the narrow entries save more memory traffic than the extra reductions cost
+    std::atomic<int> compact_elimination_threshold{COMPACT_ELIMINATION_DEFAULT};
+}
+
+void Matrix::set_compact_elimination_threshold(int size) {
+    compact_elimination_threshold.store(size, std::memory_order_relaxed);
+}
+
+int Matrix::get_compact_elimination_threshold() {
+    return compact_elimination_threshold.load(std::memory_order_relaxed);
+}
+
+void Matrix::row_echelon_form(ThreadPool* pool) {
+    if (size == 0) {
+        return;
+    }
+    bool compact = size >= get_compact_elimination_threshold();
+    switch (width) {
+        case 1:
+            if (compact) {
+                eliminate_compact(data<std::uint8_t>(), size, modp, pool);
+            } else {
+                eliminate_widened(data<std::uint8_t>(), size, modp, pool);
+            }
+            return;
+        case 2:
+            if (compact) {
+                eliminate_compact(data<std::uint16_t>(), size, modp, pool);
+            } else {
+                eliminate_widened(data<std::uint16_t>(), size, modp, pool);
+            }
+            return;
+        case 4:
+            if (compact) {
+                eliminate_compact(data<std::uint32_t>(), size, modp, pool);
+            } else {
+                eliminate_widened(data<std::uint32_t>(), size, modp, pool);
+            }
+            return;
+        default:
+            // Moduli of 32 bits and more leave no headroom for deferred sums
+            with_field(modp, [&](const auto& field) {
+                eliminate_wide(field, data<ull>(), size, pool);
+            });
     }
 }
@@ -1,7 +1,12 @@
 #pragma once
+#include <cstdint>
 #include <vector>
 #include "Polynomial.h"
 
+class ThreadPool;
+
+// Square matrix over GF(p). Entries are stored with the narrowest of 1, 2, 4 or 8 bytes that holds
+// every residue, so the Q matrix of a small prime takes an eighth of the memory of long long entries.
 class Matrix {
 public:
     Matrix(int size, ll modp);
@@ -28,10 +33,39 @@ public:
 
     void divide_row(int r, const ll& x);
 
+    // Reduced row echelon form by Gauss-Jordan elimination on contiguous row spans,
+    // the row updates of every pivot are spread over pool when it is given
+    void row_echelon_form(ThreadPool* pool = nullptr);
+
+    // Bytes per entry
+    int get_entry_width() const {
+        return width;
+    }
+
+    static int entry_width(ll modp);
+
+    // Matrices with narrow entries from this size on are eliminated in their own storage by the panel kernel.
+    // Smaller ones are widened to 64 bits for the deferred-reduction kernel and narrowed back.
+    static void set_compact_elimination_threshold(int size);
+
+    static int get_compact_elimination_threshold();
+
     friend std::ostream& operator<<(std::ostream& o, const Matrix& m);
 private:
+    template <class T>
+    T* data() {
+        return reinterpret_cast<T*>(entries.data());
+    }
+
+    template <class T>
+    const T* data() const {
+        return reinterpret_cast<const T*>(entries.data());
+    }
+
     int size;
     ll modp;
-    std::vector<ll> entries;
+    int width;
+    // size * size entries of width bytes, row-major
+    std::vector<std::uint8_t> entries;
 };
 
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+
+#include "Polynomial.h"
+
+// Arithmetic on residues stored as unsigned values in [0, modulus).
+// Every field type exposes the same interface, so kernels are templates over it:
+//   modulus(), reduce(x), add(a, b), sub(a, b), neg(a), mul(a, b), mul_add(c, a, b), pow(a, e), inv(a).
+// mul_add(c, a, b) is c + a * b for residues; narrow fields reduce the 64-bit sum once.
+// with_field picks the type for a runtime modulus once per operation, keeping the
+// hardware division out of the inner loops.
+
+typedef unsigned long long ull;
+typedef unsigned __int128 u128;
+
+template <class Derived>
+class FieldOps {
+public:
+    ull add(ull a, ull b) const {
+        ull s = a + b;
+        return s >= self().modulus() ? s - self().modulus() : s;
+    }
+
+    ull sub(ull a, ull b) const {
+        return a >= b ? a - b : a + self().modulus() - b;
+    }
+
+    ull neg(ull a) const {
+        return a == 0 ? 0 : self().modulus() - a;
+    }
+
+    ull pow(ull a, ull e) const {
+        ull res = self().reduce(1);
+        while (e > 0) {
+            if (e & 1) {
+                res = self().mul(res, a);
+            }
+            a = self().mul(a, a);
+            e >>= 1;
+        }
+        return res;
+    }
+
+    // Inverse by Fermat's little theorem, the modulus must be prime
+    ull inv(ull a) const {
+        return pow(a, self().modulus() - 2);
+    }
+
+private:
+    const Derived& self() const {
+        return static_cast<const Derived&>(*this);
+    }
+};
+
+// Modulus known at compile time: the compiler turns % P into a multiply-shift sequence
+template <ull P>
+class StaticField : public FieldOps<StaticField<P>> {
+    static_assert(P > 1 && P < (1ULL << 32), "StaticField needs products of two residues to fit into 64 bits");
+
+public:
+    constexpr ull modulus() const {
+        return P;
+    }
+
+    ull reduce(ull x) const {
+        return x % P;
+    }
+
+    ull mul(ull a, ull b) const {
+        return a * b % P;
+    }
+
+    ull mul_add(ull c, ull a, ull b) const {
+        return (c + a * b) % P;
+    }
+};
+
+// Runtime modulus below 2^32 reduced by Barrett's method with a precomputed floor(2^64 / m)
+class BarrettField : public FieldOps<BarrettField> {
+public:
+    explicit BarrettField(ull m) : m(m), im((ull) (((u128) 1 << 64) / m)) {
+        assert(m > 1 && m < (1ULL << 32));
+    }
+
+    ull modulus() const {
+        return m;
+    }
+
+    // q underestimates x / m by less than 2, so one correction step is enough
+    ull reduce(ull x) const {
+        ull q = (ull) (((u128) x * im) >> 64);
+        ull r = x - q * m;
+        return r >= m ? r - m : r;
+    }
+
+    ull mul(ull a, ull b) const {
+        return reduce(a * b);
+    }
+
+    ull mul_add(ull c, ull a, ull b) const {
+        return reduce(c + a * b);
+    }
+
+private:
+    ull m;
+    ull im;
+};
+
+// Runtime odd modulus below 2^62, where products of residues need 128 bits. Residues stay in
+// canonical form at the interface; mul runs Montgomery's REDC twice, the second time against
+// R^2 mod m, which is far cheaper than a 128-bit hardware division.
+class MontgomeryField : public FieldOps<MontgomeryField> {
+public:
+    explicit MontgomeryField(ull m) : m(m) {
+        assert(m % 2 == 1 && m < (1ULL << 62));
+        // Newton iteration for m^-1 mod 2^64, each step doubles the number of correct bits
+        ull inv = m;
+        for (int i = 0; i < 5; i++) {
+            inv *= 2 - m * inv;
+        }
+        neg_inv = 0 - inv;
+        ull r = (0 - m) % m;
+        r2 = (ull) ((u128) r * r % m);
+    }
+
+    ull modulus() const {
+        return m;
+    }
+
+    ull reduce(ull x) const {
+        return redc((u128) redc(x) * r2);
+    }
+
+    ull mul(ull a, ull b) const {
+        return redc((u128) redc((u128) a * b) * r2);
+    }
+
+    ull mul_add(ull c, ull a, ull b) const {
+        return add(c, mul(a, b));
+    }
+
+private:
+    // t * 2^-64 mod m for t < m * 2^64
+    ull redc(u128 t) const {
+        ull q = (ull) t * neg_inv;
+        ull res = (ull) ((t + (u128) q * m) >> 64);
+        return res >= m ? res - m : res;
+    }
+
+    ull m;
+    ull neg_inv;
+    ull r2;
+};
+
+// Field objects of the shared per-modulus FieldContext, see FieldContext.h
+const BarrettField& shared_barrett_field(ull modp);
+
+const MontgomeryField& shared_montgomery_field(ull modp);
+
+// Calls f with the field type matching modp and returns its result
+template <class F>
+auto with_field(ll modp, F&& f) -> decltype(f(StaticField<2>())) {
+    switch (modp) {
+        case 2:
+            return f(StaticField<2>());
+        case 3:
+            return f(StaticField<3>());
+        case 998244353:
+            return f(StaticField<998244353>());
+        default:
+            if ((ull) modp < (1ULL << 32)) {
+                return f(shared_barrett_field((ull) modp));
+            }
+            return f(shared_montgomery_field((ull) modp));
+    }
+}
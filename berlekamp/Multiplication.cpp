@@ -0,0 +1,284 @@
+#include "Multiplication.h"
+#include "CoefficientPool.h"
+#include "Modular.h"
+
+#include <algorithm>
+#include <cassert>
+#include <memory>
+#include <mutex>
+
+using namespace std;
+
+namespace {
+    // NTT primes p = c * 2^k + 1, all of them have primitive root 3
+    const ull NTT_MOD1 = 998244353, NTT_MOD2 = 167772161, NTT_MOD3 = 469762049;
+    const ull NTT_ROOT = 3;
+    // The shortest 2-adic part, 998244353 = 119 * 2^23 + 1
+    const int NTT_MAX_LOG = 23;
+
+    void trim(vector<ll>& v) {
+        while (!v.empty() && v.back() == 0) {
+            v.pop_back();
+        }
+    }
+
+    // res[0, n + m - 1) += a * b, res must be zeroed by the caller
+    template <class Field>
+    void schoolbook(const Field& field, const ll* a, size_t n, const ll* b, size_t m, ll* res) {
+        ull p = field.modulus();
+        // While n * (p - 1)^2 fits into 64 bits every sum can be reduced once at the end
+        bool lazy = (u128) (p - 1) * (p - 1) * min(n, m) < ((u128) 1 << 63);
+        if (lazy) {
+            vector<ull> acc(n + m - 1, 0);
+            for (size_t i = 0; i < n; i++) {
+                ull ai = a[i];
+                if (ai == 0) continue;
+                for (size_t j = 0; j < m; j++) {
+                    acc[i + j] += ai * (ull) b[j];
+                }
+            }
+            for (size_t i = 0; i < acc.size(); i++) {
+                res[i] = (ll) field.add((ull) res[i], field.reduce(acc[i]));
+            }
+            return;
+        }
+        for (size_t i = 0; i < n; i++) {
+            if (a[i] == 0) continue;
+            for (size_t j = 0; j < m; j++) {
+                res[i + j] = (ll) field.add((ull) res[i + j], field.mul((ull) a[i], (ull) b[j]));
+            }
+        }
+    }
+
+    void schoolbook(const ll* a, size_t n, const ll* b, size_t m, ll* res, ll modp) {
+        with_field(modp, [&](const auto& field) {
+            schoolbook(field, a, n, b, m, res);
+        });
+    }
+
+    void add_to(ll* dst, const ll* src, size_t n, ll modp) {
+        for (size_t i = 0; i < n; i++) {
+            dst[i] += src[i];
+            if (dst[i] >= modp) dst[i] -= modp;
+        }
+    }
+
+    void sub_from(ll* dst, const ll* src, size_t n, ll modp) {
+        for (size_t i = 0; i < n; i++) {
+            dst[i] -= src[i];
+            if (dst[i] < 0) dst[i] += modp;
+        }
+    }
+
+    // res[0, 2n - 1) = a * b for two operands of length n
+    void karatsuba(const ll* a, const ll* b, size_t n, ll* res, ll modp) {
+        if (n < KARATSUBA_THRESHOLD) {
+            fill(res, res + 2 * n - 1, 0);
+            schoolbook(a, n, b, n, res, modp);
+            return;
+        }
+        size_t k = n / 2;
+        size_t h = n - k;
+        vector<ll> z0(2 * k - 1), z2(2 * h - 1), z1(2 * h - 1);
+        karatsuba(a, b, k, z0.data(), modp);
+        karatsuba(a + k, b + k, h, z2.data(), modp);
+
+        vector<ll> as(a + k, a + n), bs(b + k, b + n);
+        add_to(as.data(), a, k, modp);
+        add_to(bs.data(), b, k, modp);
+        karatsuba(as.data(), bs.data(), h, z1.data(), modp);
+        sub_from(z1.data(), z0.data(), z0.size(), modp);
+        sub_from(z1.data(), z2.data(), z2.size(), modp);
+
+        fill(res, res + 2 * n - 1, 0);
+        copy(z0.begin(), z0.end(), res);
+        copy(z2.begin(), z2.end(), res + 2 * k);
+        add_to(res + k, z1.data(), z1.size(), modp);
+    }
+
+    // Powers of the n-th root of unity for a transform of length n. Level len of the transform
+    // uses every (n / len)-th of them. They are fixed, so they are multiplied with Shoup's trick:
+    // with w' = floor(w * 2^64 / MOD), a * w - mulhi(a, w') * MOD lies in [0, 2 * MOD).
+    struct Twiddles {
+        vector<ull> ws;
+        vector<ull> ws_shoup;
+    };
+
+    // Tables are built once per (length, direction) and shared by all later transforms
+    template <ull MOD>
+    const Twiddles& twiddles(size_t n, bool invert) {
+        static std::mutex lock;
+        static std::unique_ptr<Twiddles> cache[2][NTT_MAX_LOG + 1];
+        int lg = 0;
+        while (((size_t) 1 << lg) < n) {
+            lg++;
+        }
+        std::lock_guard<std::mutex> guard(lock);
+        auto& entry = cache[invert][lg];
+        if (!entry) {
+            const StaticField<MOD> field;
+            ull w = field.pow(NTT_ROOT, (MOD - 1) / n);
+            if (invert) {
+                w = field.inv(w);
+            }
+            entry.reset(new Twiddles());
+            entry->ws.resize(max<size_t>(n / 2, 1));
+            entry->ws_shoup.resize(entry->ws.size());
+            entry->ws[0] = 1;
+            for (size_t i = 1; i < n / 2; i++) {
+                entry->ws[i] = field.mul(entry->ws[i - 1], w);
+            }
+            for (size_t i = 0; i < entry->ws.size(); i++) {
+                entry->ws_shoup[i] = (ull) (((u128) entry->ws[i] << 64) / MOD);
+            }
+        }
+        return *entry;
+    }
+
+    template <ull MOD>
+    void ntt(vector<ull>& a, bool invert) {
+        const StaticField<MOD> field;
+        size_t n = a.size();
+        for (size_t i = 1, j = 0; i < n; i++) {
+            size_t bit = n >> 1;
+            for (; j & bit; bit >>= 1) {
+                j ^= bit;
+            }
+            j ^= bit;
+            if (i < j) {
+                swap(a[i], a[j]);
+            }
+        }
+        const auto& tw = twiddles<MOD>(n, invert);
+        const auto& ws = tw.ws;
+        const auto& ws_shoup = tw.ws_shoup;
+        for (size_t len = 2; len <= n; len <<= 1) {
+            size_t stride = n / len;
+            for (size_t i = 0; i < n; i += len) {
+                for (size_t j = 0; j < len / 2; j++) {
+                    ull u = a[i + j];
+                    ull x = a[i + j + len / 2];
+                    ull q = (ull) (((u128) x * ws_shoup[j * stride]) >> 64);
+                    ull v = x * ws[j * stride] - q * MOD;
+                    v = v >= MOD ? v - MOD : v;
+                    a[i + j] = field.add(u, v);
+                    a[i + j + len / 2] = field.sub(u, v);
+                }
+            }
+        }
+        if (invert) {
+            ull n_inv = field.inv(n);
+            for (auto& x : a) {
+                x = field.mul(x, n_inv);
+            }
+        }
+    }
+
+    // Exact cyclic convolution of a and b modulo MOD
+    template <ull MOD>
+    vector<ull> convolve(const vector<ll>& a, const vector<ll>& b, size_t sz) {
+        const StaticField<MOD> field;
+        vector<ull> fa(sz, 0), fb(sz, 0);
+        for (size_t i = 0; i < a.size(); i++) fa[i] = field.reduce((ull) a[i]);
+        for (size_t i = 0; i < b.size(); i++) fb[i] = field.reduce((ull) b[i]);
+        ntt<MOD>(fa, false);
+        ntt<MOD>(fb, false);
+        for (size_t i = 0; i < sz; i++) {
+            fa[i] = field.mul(fa[i], fb[i]);
+        }
+        ntt<MOD>(fa, true);
+        fa.resize(a.size() + b.size() - 1);
+        return fa;
+    }
+}
+
+vector<ll> multiply_schoolbook(const vector<ll>& a, const vector<ll>& b, ll modp) {
+    if (a.empty() || b.empty()) {
+        return {};
+    }
+    vector<ll> res = CoefficientPool::acquire_zeros(a.size() + b.size() - 1);
+    schoolbook(a.data(), a.size(), b.data(), b.size(), res.data(), modp);
+    trim(res);
+    return res;
+}
+
+vector<ll> multiply_karatsuba(const vector<ll>& a, const vector<ll>& b, ll modp) {
+    if (a.empty() || b.empty()) {
+        return {};
+    }
+    const vector<ll>& lng = a.size() >= b.size() ? a : b;
+    const vector<ll>& sht = a.size() >= b.size() ? b : a;
+    size_t m = sht.size();
+    vector<ll> res = CoefficientPool::acquire_zeros(a.size() + b.size() - 1);
+    // Cut the longer operand into blocks of the shorter one's length so each block product is balanced
+    vector<ll> block(m), prod(2 * m - 1);
+    for (size_t start = 0; start < lng.size(); start += m) {
+        size_t len = min(m, lng.size() - start);
+        fill(block.begin(), block.end(), 0);
+        copy(lng.begin() + start, lng.begin() + start + len, block.begin());
+        karatsuba(block.data(), sht.data(), m, prod.data(), modp);
+        add_to(res.data() + start, prod.data(), min(prod.size(), res.size() - start), modp);
+    }
+    trim(res);
+    return res;
+}
+
+vector<ll> multiply_ntt(const vector<ll>& a, const vector<ll>& b, ll modp) {
+    if (a.empty() || b.empty()) {
+        return {};
+    }
+    size_t n = a.size() + b.size() - 1;
+    size_t sz = 1;
+    int lg = 0;
+    while (sz < n) {
+        sz <<= 1;
+        lg++;
+    }
+    if ((ull) modp == NTT_MOD1 && lg <= NTT_MAX_LOG) {
+        auto c = convolve<NTT_MOD1>(a, b, sz);
+        vector<ll> res = CoefficientPool::acquire(n);
+        res.assign(c.begin(), c.begin() + n);
+        trim(res);
+        return res;
+    }
+
+    const ull m1 = NTT_MOD1, m2 = NTT_MOD2, m3 = NTT_MOD3;
+    u128 bound = (u128) (modp - 1) * (ull) (modp - 1) * min(a.size(), b.size());
+    if (lg > NTT_MAX_LOG || bound >= (u128) m1 * m2 * m3) {
+        return multiply_karatsuba(a, b, modp);
+    }
+
+    auto c1 = convolve<NTT_MOD1>(a, b, sz);
+    auto c2 = convolve<NTT_MOD2>(a, b, sz);
+    auto c3 = convolve<NTT_MOD3>(a, b, sz);
+
+    // Garner: x = r1 + m1 * k1 + m1 * m2 * k2
+    const StaticField<NTT_MOD2> f2;
+    const StaticField<NTT_MOD3> f3;
+    const ull m1_inv_m2 = f2.inv(m1 % m2);
+    const ull m12_inv_m3 = f3.inv(f3.mul(m1 % m3, m2 % m3));
+    vector<ll> res = CoefficientPool::acquire_zeros(n);
+    with_field(modp, [&](const auto& field) {
+        const ull m12_mod_p = field.mul(field.reduce(m1), field.reduce(m2));
+        for (size_t i = 0; i < n; i++) {
+            ull r1 = c1[i], r2 = c2[i], r3 = c3[i];
+            ull k1 = f2.mul(f2.sub(r2, f2.reduce(r1)), m1_inv_m2);
+            ull x12 = r1 + m1 * k1;
+            ull k2 = f3.mul(f3.sub(r3, f3.reduce(x12)), m12_inv_m3);
+            res[i] = (ll) field.add(field.reduce(x12), field.mul(m12_mod_p, field.reduce(k2)));
+        }
+    });
+    trim(res);
+    return res;
+}
+
+vector<ll> multiply_coefficients(const vector<ll>& a, const vector<ll>& b, ll modp) {
+    size_t m = min(a.size(), b.size());
+    if (m < KARATSUBA_THRESHOLD) {
+        return multiply_schoolbook(a, b, modp);
+    }
+    if (m < NTT_THRESHOLD) {
+        return multiply_karatsuba(a, b, modp);
+    }
+    return multiply_ntt(a, b, modp);
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <vector>
+
+#include "Polynomial.h"
+
+// Coefficient vectors are little-endian (index = power of x) with entries in [0, modp).
+// multiply_coefficients picks the engine by the size of the shorter operand:
+// schoolbook below KARATSUBA_THRESHOLD, Karatsuba below NTT_THRESHOLD and NTT above it.
+
+const size_t KARATSUBA_THRESHOLD = 32;
+const size_t NTT_THRESHOLD = 768;
+
+std::vector<ll> multiply_coefficients(const std::vector<ll>& a, const std::vector<ll>& b, ll modp);
+
+std::vector<ll> multiply_schoolbook(const std::vector<ll>& a, const std::vector<ll>& b, ll modp);
+
+std::vector<ll> multiply_karatsuba(const std::vector<ll>& a, const std::vector<ll>& b, ll modp);
+
+// Runs a single NTT when modp is itself one of the NTT primes, otherwise three NTTs joined by CRT.
+// Falls back to Karatsuba when the exact product coefficients could exceed the CRT range.
+std::vector<ll> multiply_ntt(const std::vector<ll>& a, const std::vector<ll>& b, ll modp);
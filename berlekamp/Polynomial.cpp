@@ -1,4 +1,10 @@
 #include "Polynomial.h"
+#include "CoefficientPool.h"
+#include "FieldContext.h"
+#include "Modular.h"
+#include "Stats.h"
+#include "Multiplication.h"
+#include "PolynomialModulus.h"
 
 #include <string>
 #include <algorithm>
@@ -6,68 +12,151 @@
 #include <random>
 #include <iostream>
 #include <cassert>
+#include <atomic>
+#include <stdexcept>
 
 using namespace std;
 
 namespace {
-    std::vector<std::string> split_by(std::string s, std::string delimiter) {
-        std::vector<std::string> result;
+    std::atomic<int> parse_degree_limit{1 << 20};
 
-        auto start = 0U;
-        auto end = s.find(delimiter);
-        while (end != std::string::npos)
-        {
-            result.push_back(s.substr(start, end - start));
-            start = end + delimiter.length();
-            end = s.find(delimiter, start);
+    // Divisors with at most SPARSE_TERMS_LIMIT terms below the leading one, and at most one per
+    // SPARSE_TERMS_RATIO positions, take the sparse long division
+    const int SPARSE_TERMS_LIMIT = 32;
+    const int SPARSE_TERMS_RATIO = 4;
+
+    bool is_space(char c) {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+    }
+
+    const char* skip_spaces(const char* p, const char* last) {
+        while (p != last && is_space(*p)) {
+            p++;
         }
+        return p;
+    }
 
-        result.push_back(s.substr(start, end));
+    bool is_digit(char c) {
+        return c >= '0' && c <= '9';
+    }
 
-        return result;
+    // Writes the decimal digits of x so that they end at buf_end, returns where they start
+    char* reversed_digits(ull x, char* buf_end) {
+        char* p = buf_end;
+        do {
+            *--p = (char) ('0' + x % 10);
+            x /= 10;
+        } while (x != 0);
+        return p;
+    }
+
+    char* append(char* first, char* last, const char* begin, const char* end) {
+        if (first == nullptr || last - first < end - begin) {
+            return nullptr;
+        }
+        std::copy(begin, end, first);
+        return first + (end - begin);
     }
 }
 
-Polynomial::Polynomial(std::string str, ll modp) : modp(modp) {
-    try {
-        auto monoms_string = split_by(str, "+");
-        vector<pair<ll, int>> monoms(monoms_string.size());
-        for (size_t i = 0; i < monoms.size(); i++) {
-            auto ss = split_by(monoms_string[i], "x");
-            ll coeff;
-            int pwr;
+ParseResult Polynomial::parse(const char* first, const char* last, ll modp, Polynomial& result, char variable) {
+    const char* p = skip_spaces(first, last);
+    if (p == last) {
+        return {ParseStatus::Empty, (size_t) (p - first)};
+    }
+    auto fail = [&](ParseStatus status) {
+        return ParseResult{status, (size_t) (p - first)};
+    };
+    ll limit = parse_degree_limit.load(std::memory_order_relaxed);
+    vector<ll> c;
+    bool first_term = true;
+    while (p != last) {
+        bool negative = false;
+        if (*p == '+' || *p == '-') {
+            negative = *p == '-';
+            p = skip_spaces(p + 1, last);
+        } else if (!first_term) {
+            return fail(ParseStatus::UnexpectedCharacter);
+        }
+        first_term = false;
+
+        // Coefficient, reduced once it grows large so any number of digits fits
+        bool has_coefficient = false;
+        u128 value = 0;
+        while (p != last && is_digit(*p)) {
+            value = value * 10 + (*p - '0');
+            if (value >> 100) {
+                value %= (ull) modp;
+            }
+            has_coefficient = true;
+            p++;
+        }
+        ll coefficient = has_coefficient ? (ll) (value % (ull) modp) : 1 % modp;
+        p = skip_spaces(p, last);
+        if (has_coefficient && p != last && *p == '*') {
+            p = skip_spaces(p + 1, last);
+            if (p == last || *p != variable) {
+                return fail(ParseStatus::UnexpectedCharacter);
+            }
+        }
 
-            if (ss.size() == 1) {
-                pwr = 0;
-            } else {
-                if (ss[1] == "") {
-                    pwr = 1;
-                } else {
-                    pwr = stoi(ss[1].substr(1, ss[1].size()));
+        ll power = 0;
+        if (p != last && *p == variable) {
+            power = 1;
+            p = skip_spaces(p + 1, last);
+            if (p != last && *p == '^') {
+                p = skip_spaces(p + 1, last);
+                if (p == last || !is_digit(*p)) {
+                    return fail(ParseStatus::UnexpectedCharacter);
+                }
+                const char* digits = p;
+                power = 0;
+                while (p != last && is_digit(*p)) {
+                    power = power * 10 + (*p - '0');
+                    p++;
+                    if (power > limit) {
+                        p = digits;
+                        return fail(ParseStatus::DegreeTooLarge);
+                    }
                 }
+                p = skip_spaces(p, last);
             }
+        } else if (!has_coefficient) {
+            return fail(ParseStatus::UnexpectedCharacter);
+        }
 
-            if (ss[0] == "") {
-                coeff = 1;
-            } else {
-                coeff = stoull(ss[0]);
-            }
-            monoms[i] = { coeff, pwr };
+        if ((ll) c.size() <= power) {
+            c.resize(power + 1, 0);
+        }
+        if (negative && coefficient != 0) {
+            coefficient = modp - coefficient;
+        }
+        c[power] += coefficient;
+        if (c[power] >= modp) {
+            c[power] -= modp;
         }
+    }
+    result = Polynomial(move(c), modp);
+    return {ParseStatus::Ok, (size_t) (last - first)};
+}
 
+Polynomial::Polynomial(const std::string& str, ll modp) : modp(modp) {
+    auto parsed = parse(str.data(), str.data() + str.size(), modp, *this);
+    if (parsed.status != ParseStatus::Ok) {
+        throw std::invalid_argument("cannot parse polynomial \"" + str + "\" at position " +
+                                    std::to_string(parsed.position));
+    }
+}
 
-        int pwr = monoms[0].second;
-        vector<ll> result(pwr + 1);
 
-        for (auto pr : monoms)
-        {
-            result[pr.second] = pr.first;
-        }
+Polynomial::Polynomial(const Polynomial &polynomial) : coeff(CoefficientPool::acquire(polynomial.coeff.size())),
+    modp(polynomial.modp) {
+    coeff.assign(polynomial.coeff.begin(), polynomial.coeff.end());
+}
 
-        coeff = result;
-    } catch (...) {
-        cout << "Error during polynomial parse" << endl;
-    }
+
+Polynomial::~Polynomial() {
+    CoefficientPool::release(coeff);
 }
 
 
@@ -88,58 +177,78 @@ int Polynomial::get_degree() const {
 
 std::string Polynomial::to_string(const std::string& default_variable_name) const
 {
-    if (coeff.empty()) {
-        return "0";
-    }
+    // Every term takes at most 20 digits, the variable, '^', 10 digits and '+'
+    size_t terms = coeff.empty() ? 1 : coeff.size() - std::count(coeff.begin(), coeff.end(), 0LL);
+    std::string result(terms * (default_variable_name.size() + 32), '\0');
+    char* end = format(&result[0], &result[0] + result.size(), default_variable_name);
+    result.resize(end - &result[0]);
+    return result;
+}
 
-    int degree = get_degree();
 
-    std::string result;
+char* Polynomial::format(char* first, char* last, const std::string& variable) const
+{
+    if (coeff.empty()) {
+        static const char zero[] = "0";
+        return append(first, last, zero, zero + 1);
+    }
 
-    for (int i = degree; i >= 0; i--)
+    char digits[24];
+    char* digits_end = digits + sizeof(digits);
+    bool empty = true;
+    for (int i = get_degree(); i >= 0 && first != nullptr; i--)
     {
         if (coeff[i] == 0) continue;
-        if (!result.empty()) {
-            result += "+";
+        if (!empty) {
+            static const char plus[] = "+";
+            first = append(first, last, plus, plus + 1);
         }
+        empty = false;
 
         if (coeff[i] != 1 || i == 0) {
-            result += std::to_string(coeff[i]);
+            first = append(first, last, reversed_digits((ull) coeff[i], digits_end), digits_end);
         }
         if (i != 0) {
-            result += default_variable_name;
+            first = append(first, last, variable.data(), variable.data() + variable.size());
             if (i != 1) {
-                result += "^" + std::to_string(i);
+                static const char caret[] = "^";
+                first = append(first, last, caret, caret + 1);
+                first = append(first, last, reversed_digits((ull) i, digits_end), digits_end);
             }
         }
     }
 
-    return result;
+    return first;
 }
 
 
-Polynomial Polynomial::diff() const {
-    vector<ll> v(get_degree());
+void Polynomial::set_parse_degree_limit(int degree) {
+    parse_degree_limit.store(degree, std::memory_order_relaxed);
+}
 
-    for (size_t i = 0; i < get_degree(); i++)
-    {
-        v[i] = (coeff[i + 1] * (i + 1)) % modp;
-    }
+int Polynomial::get_parse_degree_limit() {
+    return parse_degree_limit.load(std::memory_order_relaxed);
+}
 
-    auto p = Polynomial(v, modp);
-    p.prune();
+Polynomial Polynomial::diff() const {
+    vector<ll> v = CoefficientPool::acquire_zeros(get_degree());
 
-    return p;
+    with_field(modp, [&](const auto& field) {
+        for (int i = 0; i < get_degree(); i++)
+        {
+            v[i] = field.mul(field.reduce(coeff[i + 1]), field.reduce(i + 1));
+        }
+    });
+
+    return Polynomial(std::move(v), modp);
 }
 
 Polynomial Polynomial::get_pth_root() const {
     vector <ll> root_coeff(get_degree() / modp + 1);
-    for (int i = 0; i <= get_degree(); i += modp) {
+    for (ll i = 0; i <= get_degree(); i += modp) {
         root_coeff[i / modp] = coeff[i];
     }
-    auto res = Polynomial(root_coeff, modp);
-    res.prune();
-    return res;
+    return Polynomial(std::move(root_coeff), modp);
 }
 
 
@@ -150,95 +259,210 @@ std::ostream& operator<<(std::ostream& strm, const Polynomial& poly) {
 
 Polynomial Polynomial::add(const Polynomial & a, const Polynomial & b) {
     assert(a.modp == b.modp);
-    if (a.is_zero()) {
-        return b;
+    bool a_longer = a.coeff.size() >= b.coeff.size();
+    Polynomial p = a_longer ? a : b;
+    p += a_longer ? b : a;
+    return p;
+}
+
+
+Polynomial& Polynomial::operator+=(const Polynomial & rhs) {
+    assert(modp == rhs.modp);
+    if (coeff.size() < rhs.coeff.size()) {
+        coeff.resize(rhs.coeff.size(), 0);
     }
-    if (b.is_zero()) {
-        return a;
+    with_field(modp, [&](const auto& field) {
+        for (size_t i = 0; i < rhs.coeff.size(); i++) {
+            coeff[i] = field.reduce(coeff[i] + rhs.coeff[i]);
+        }
+    });
+    prune();
+    return *this;
+}
+
+
+Polynomial& Polynomial::operator-=(const Polynomial & rhs) {
+    assert(modp == rhs.modp);
+    if (coeff.size() < rhs.coeff.size()) {
+        coeff.resize(rhs.coeff.size(), 0);
     }
+    with_field(modp, [&](const auto& field) {
+        for (size_t i = 0; i < rhs.coeff.size(); i++) {
+            coeff[i] = field.reduce(coeff[i] + (rhs.coeff[i] == 0 ? 0 : modp - rhs.coeff[i]));
+        }
+    });
+    prune();
+    return *this;
+}
 
-    const Polynomial& a1 = a.get_degree() > b.get_degree() ? a : b;
-    const Polynomial& b1 = a.get_degree() > b.get_degree() ? b : a;
 
-    std::vector<ll> v(a1.get_degree() + 1);
+Polynomial& Polynomial::operator*=(const Polynomial & rhs) {
+    *this = mul(*this, rhs);
+    return *this;
+}
 
-    for (size_t i = 0; i <= b1.get_degree(); i++)
-    {
-        v[i] = (a1.coeff[i] + b1.coeff[i] + a.modp) % a.modp;
-    }
 
-    for (size_t i = b1.get_degree() + 1; i <= a1.get_degree(); i++)
-    {
-        v[i] = a1.coeff[i];
+Polynomial& Polynomial::operator%=(const Polynomial & rhs) {
+    assert(modp == rhs.modp);
+    if (get_degree() - rhs.get_degree() + 1 >= PolynomialModulus::NEWTON_DIVISION_THRESHOLD &&
+        rhs.get_degree() >= PolynomialModulus::NEWTON_DIVISION_THRESHOLD && !sparse_terms(rhs, nullptr)) {
+        *this = div_internal(*this, rhs).second;
+        return *this;
     }
+    remainder_classic(coeff, rhs, inverse(rhs.coeff.back(), modp), nullptr);
+    prune();
+    return *this;
+}
 
-    Polynomial p = Polynomial(v, a.modp);
-    p.prune();
-    return p;
+
+Polynomial& Polynomial::operator%=(const PolynomialModulus & rhs) {
+    rhs.reduce_inplace(*this);
+    return *this;
+}
+
+
+void Polynomial::mulmod_inplace(const Polynomial& rhs, const PolynomialModulus& m) {
+    *this *= rhs;
+    m.reduce_inplace(*this);
 }
 
 
 Polynomial Polynomial::mul(const Polynomial & a, const Polynomial & b) {
     assert(a.modp == b.modp);
     if (a.is_zero() || b.is_zero()) {
-        return Polynomial();
+        return Polynomial(vector<ll>{}, a.modp);
     }
 
-    std::vector<ll> v(a.get_degree() + b.get_degree() + 1);
+    count_operation(&OperationCounters::mul_calls, a.coeff.size() + b.coeff.size());
+    return Polynomial(multiply_coefficients(a.coeff, b.coeff, a.modp), a.modp);
+}
+
 
-    for (int i = 0; i <= a.get_degree(); ++i) {
-        for (int j = 0; j <= b.get_degree(); ++j) {
-            v[i + j] = (v[i + j] + a.coeff[i] * b.coeff[j] % a.modp + a.modp) % a.modp;
-        }
-    }
 
-    return Polynomial(v, a.modp);
+Polynomial Polynomial::sub(const Polynomial & a, const Polynomial & b) {
+    Polynomial p = a;
+    p -= b;
+    return p;
 }
 
 
+std::pair< Polynomial, Polynomial> Polynomial::div_internal(const Polynomial & a, const Polynomial & b) {
+    assert(a.modp == b.modp);
+    if (a.get_degree() - b.get_degree() + 1 >= PolynomialModulus::NEWTON_DIVISION_THRESHOLD &&
+        b.get_degree() >= PolynomialModulus::NEWTON_DIVISION_THRESHOLD && !sparse_terms(b, nullptr)) {
+        return PolynomialModulus(b, a.get_degree()).divide(a);
+    }
+    return div_classic(a, b, inverse(b.coeff.back(), b.modp));
+}
 
-Polynomial Polynomial::sub(const Polynomial & a, const Polynomial & b) {
-    vector<ll> v = b.coeff;
 
-    for (int i = 0; i < v.size(); i++) {
-        v[i] = a.modp - v[i];
+std::pair< Polynomial, Polynomial> Polynomial::div_classic(const Polynomial & a, const Polynomial & b, const ll & lead_inverse) {
+    assert(a.modp == b.modp);
+    if (a.get_degree() - b.get_degree() + 1 < 1 || a.is_zero()) {
+        count_operation(&OperationCounters::mod_calls, a.coeff.size() + b.coeff.size());
+        return { Polynomial(vector<ll>{}, a.modp), a };
     }
 
-    return add(a, Polynomial(v, a.modp));
+    std::vector<ll> coeff_result;
+    std::vector<ll> at = CoefficientPool::acquire(a.coeff.size());
+    at.assign(a.coeff.begin(), a.coeff.end());
+    remainder_classic(at, b, lead_inverse, &coeff_result);
+
+    return { Polynomial(std::move(coeff_result), a.modp), Polynomial(std::move(at), a.modp) };
 }
 
 
-std::pair< Polynomial, Polynomial> Polynomial::div_internal(const Polynomial & a, const Polynomial & b) {
-    assert(a.modp == b.modp);
-    ll bl = b.coeff.back();
-    Polynomial b2 = b.normalize();
+bool Polynomial::sparse_terms(const Polynomial& b, std::vector<std::pair<int, ll>>* terms) {
+    int db = b.get_degree();
+    int count = 0;
+    for (int i = 0; i < db; i++) {
+        if (b.coeff[i] != 0 && (++count > SPARSE_TERMS_LIMIT || SPARSE_TERMS_RATIO * count > db)) {
+            return false;
+        }
+    }
+    if (terms) {
+        terms->clear();
+        for (int i = 0; i < db; i++) {
+            if (b.coeff[i] != 0) {
+                terms->emplace_back(i, b.coeff[i]);
+            }
+        }
+    }
+    return true;
+}
 
-    int degree_of_result = a.get_degree() - b.get_degree() + 1;
 
+void Polynomial::remainder_sparse(std::vector<ll>& at, const Polynomial& b, const std::vector<std::pair<int, ll>>& terms,
+                                  const ll& lead_inverse, std::vector<ll>* quotient) {
+    count_operation(&OperationCounters::mod_calls, at.size() + terms.size());
+    int da = (int) at.size() - 1;
+    int db = b.get_degree();
+    int degree_of_result = da - db + 1;
     if (degree_of_result < 1) {
-        return { Polynomial(), a };
+        return;
+    }
+    if (quotient) {
+        *quotient = CoefficientPool::acquire_zeros(degree_of_result);
     }
 
-    std::vector<ll> coeff_result(degree_of_result);
+    with_field(b.modp, [&](const auto& field) {
+        // x^db = -lead_inverse * sum b_i x^i mod b, so the top coefficient only touches the positions of the terms
+        for (int top = da; top >= db; top--) {
+            ull c = field.mul(field.reduce(at[top]), lead_inverse);
+            if (quotient) {
+                (*quotient)[top - db] = c;
+            }
+            if (c == 0) continue;
 
-    Polynomial at = a;
+            ull neg = field.neg(c);
+            for (const auto& term : terms) {
+                ll& x = at[top - db + term.first];
+                x = field.mul_add(field.reduce(x), neg, term.second);
+            }
+        }
+    });
 
-    for (int i = 0; i < degree_of_result; i++)
-    {
-        coeff_result[degree_of_result - 1 - i] = at.coeff[a.get_degree() - i];
+    at.resize(db);
+}
 
-        for (int j = 0; j <= b2.get_degree(); j++)
-        {
-            at.coeff[a.get_degree() - i - j] = (at.coeff[a.get_degree() - i - j] - coeff_result[degree_of_result - 1 - i] * b2.coeff[b2.get_degree() - j]) % a.modp;
-            at.coeff[a.get_degree() - i - j] = (at.coeff[a.get_degree() - i - j] + a.modp) % a.modp;
-        }
+
+void Polynomial::remainder_classic(std::vector<ll>& at, const Polynomial& b, const ll& lead_inverse,
+                                   std::vector<ll>* quotient) {
+    std::vector<std::pair<int, ll>> terms;
+    if (sparse_terms(b, &terms)) {
+        remainder_sparse(at, b, terms, lead_inverse, quotient);
+        return;
+    }
+    count_operation(&OperationCounters::mod_calls, at.size() + b.coeff.size());
+    int da = (int) at.size() - 1;
+    int db = b.get_degree();
+    int degree_of_result = da - db + 1;
+    if (degree_of_result < 1) {
+        return;
+    }
+    if (quotient) {
+        *quotient = CoefficientPool::acquire_zeros(degree_of_result);
     }
 
-    Polynomial quo = mul(Polynomial(coeff_result, a.modp), Polynomial(vector<ll>{ bl }, a.modp));
-    
-    at.prune();
+    with_field(b.modp, [&](const auto& field) {
+        for (int i = 0; i < degree_of_result; i++)
+        {
+            int top = da - i;
+            ull c = field.mul(field.reduce(at[top]), lead_inverse);
+            if (quotient) {
+                (*quotient)[degree_of_result - 1 - i] = c;
+            }
+            if (c == 0) continue;
 
-    return { quo, at };
+            ull neg = field.neg(c);
+            for (int j = 0; j <= db; j++)
+            {
+                at[top - j] = field.mul_add(field.reduce(at[top - j]), neg, b.coeff[db - j]);
+            }
+        }
+    });
+
+    at.resize(db);
 }
 
 
@@ -248,7 +472,14 @@ Polynomial Polynomial::div(const Polynomial & a, const Polynomial & b) {
 
 
 Polynomial Polynomial::mod(const Polynomial & a, const Polynomial & b) {
-    return Polynomial::div_internal(a, b).second;
+    Polynomial r = a;
+    r %= b;
+    return r;
+}
+
+
+Polynomial Polynomial::mod(const Polynomial & a, const PolynomialModulus & b) {
+    return b.reduce(a);
 }
 
 
@@ -282,8 +513,130 @@ bool operator< (const Polynomial &poly1, const Polynomial &poly2) {
 }
 
 
+namespace {
+    std::atomic<int> half_gcd_threshold{8192};
+
+    // Below this degree half_gcd runs the Euclidean steps directly instead of recursing
+    const int HALF_GCD_BASE = 32;
+
+    int degree_of(const Polynomial& p) {
+        return p.is_zero() ? -1 : p.get_degree();
+    }
+}
+
+struct Polynomial::EuclidMatrix {
+    Polynomial m00, m01, m10, m11;
+
+    static EuclidMatrix identity(ll modp) {
+        Polynomial zero(vector<ll>{}, modp);
+        Polynomial one = Polynomial::get_one(modp);
+        return { one, zero, zero, one };
+    }
+
+    // Left-multiplies by the Euclidean step (a, b) -> (b, a - q b)
+    void push_step(const Polynomial& q) {
+        Polynomial n10 = m00 - q * m10;
+        Polynomial n11 = m01 - q * m11;
+        m00 = std::move(m10);
+        m01 = std::move(m11);
+        m10 = std::move(n10);
+        m11 = std::move(n11);
+    }
+
+    void apply(Polynomial& a, Polynomial& b) const {
+        Polynomial na = m00 * a + m01 * b;
+        b = m10 * a + m11 * b;
+        a = na;
+    }
+
+    // Returns this * rhs, that is rhs applied first
+    EuclidMatrix operator*(const EuclidMatrix& rhs) const {
+        return {
+            m00 * rhs.m00 + m01 * rhs.m10, m00 * rhs.m01 + m01 * rhs.m11,
+            m10 * rhs.m00 + m11 * rhs.m10, m10 * rhs.m01 + m11 * rhs.m11,
+        };
+    }
+};
+
+
+Polynomial Polynomial::shift_right(int k) const {
+    if (k >= (int) coeff.size()) {
+        return Polynomial(vector<ll>{}, modp);
+    }
+    return Polynomial(vector<ll>(coeff.begin() + k, coeff.end()), modp);
+}
+
+
+Polynomial::EuclidMatrix Polynomial::half_gcd(const Polynomial& a0, const Polynomial& b0) {
+    ll modp = a0.modp;
+    int m = (degree_of(a0) + 1) / 2;
+    if (degree_of(b0) < m) {
+        return EuclidMatrix::identity(modp);
+    }
+    if (degree_of(a0) < HALF_GCD_BASE) {
+        auto res = EuclidMatrix::identity(modp);
+        Polynomial a = a0, b = b0;
+        while (degree_of(b) >= m) {
+            auto qr = div_internal(a, b);
+            res.push_step(qr.first);
+            a = b;
+            b = qr.second;
+        }
+        return res;
+    }
+
+    // The quotients of the leading halves are the first quotients of the whole sequence
+    auto r = half_gcd(a0.shift_right(m), b0.shift_right(m));
+    Polynomial a = a0, b = b0;
+    r.apply(a, b);
+    if (degree_of(b) < m) {
+        return r;
+    }
+
+    auto qr = div_internal(a, b);
+    r.push_step(qr.first);
+    a = b;
+    b = qr.second;
+    if (degree_of(b) < m) {
+        return r;
+    }
+
+    int k = 2 * m - degree_of(a);
+    return half_gcd(a.shift_right(k), b.shift_right(k)) * r;
+}
+
+
+Polynomial Polynomial::gcd_internal(Polynomial a, Polynomial b, EuclidMatrix* m) {
+    int threshold = half_gcd_threshold.load(std::memory_order_relaxed);
+    while (!b.is_zero()) {
+        if (b.get_degree() >= threshold) {
+            auto h = half_gcd(a, b);
+            h.apply(a, b);
+            if (m) {
+                *m = h * *m;
+            }
+            if (b.is_zero()) {
+                break;
+            }
+        }
+        if (m) {
+            auto qr = div_internal(a, b);
+            m->push_step(qr.first);
+            a = std::move(b);
+            b = std::move(qr.second);
+        } else {
+            // Without the matrix only the remainder is needed, which fits into a's storage
+            a %= b;
+            swap(a, b);
+        }
+    }
+    return a;
+}
+
+
 Polynomial Polynomial::gcd(const Polynomial& a1, const Polynomial& b1) {
-    assert(a1.modp == a1.modp);
+    assert(a1.modp == b1.modp);
+    count_operation(&OperationCounters::gcd_calls, a1.coeff.size() + b1.coeff.size());
     if (a1.is_zero()) {
         return b1;
     }
@@ -293,46 +646,69 @@ Polynomial Polynomial::gcd(const Polynomial& a1, const Polynomial& b1) {
 
     auto a = a1.normalize();
     auto b = b1.normalize();
+    if (a.get_degree() < b.get_degree()) {
+        swap(a, b);
+    }
 
-    while (!b.is_zero()) {
-        a = Polynomial::mod(a, b);
-        auto z = a;
-        a = b;
-        b = z;
+    return gcd_internal(a, b, nullptr).normalize();
+}
+
+
+std::tuple<Polynomial, Polynomial, Polynomial> Polynomial::ext_gcd(const Polynomial& a, const Polynomial& b) {
+    assert(a.modp == b.modp);
+    count_operation(&OperationCounters::gcd_calls, a.coeff.size() + b.coeff.size());
+    ll modp = a.modp;
+    Polynomial zero(vector<ll>{}, modp);
+    if (a.is_zero() && b.is_zero()) {
+        return std::make_tuple(zero, zero, zero);
+    }
+
+    bool swapped = a.get_degree() < b.get_degree() || a.is_zero();
+    auto m = EuclidMatrix::identity(modp);
+    auto g = swapped ? gcd_internal(b, a, &m) : gcd_internal(a, b, &m);
+
+    // g = m00 * first + m01 * second, scale everything to make g monic
+    Polynomial scale(vector<ll>{ inverse(g.coeff.back(), modp) }, modp);
+    Polynomial s = m.m00 * scale, t = m.m01 * scale;
+    if (swapped) {
+        swap(s, t);
     }
-    return a.normalize();
+    return std::make_tuple(g * scale, s, t);
+}
+
+
+void Polynomial::set_half_gcd_threshold(int degree) {
+    half_gcd_threshold.store(degree, std::memory_order_relaxed);
+}
+
+
+int Polynomial::get_half_gcd_threshold() {
+    return half_gcd_threshold.load(std::memory_order_relaxed);
 }
 
 Polynomial Polynomial::powmod(const Polynomial &a, ll b, const Polynomial &mod){
-    assert(a.modp == mod.modp);
+    return powmod(a, b, PolynomialModulus(mod));
+}
+
+Polynomial Polynomial::powmod(const Polynomial &a, ll b, const PolynomialModulus &mod){
+    assert(a.modp == mod.get_modp());
     ll power = b;
     Polynomial rez = Polynomial::get_one(a.modp);
-    Polynomial aa = a;
+    Polynomial aa = mod.reduce(a);
     while (power > 0) {
         if (power % 2 == 1) {
-            rez = Polynomial::mul(rez, aa);
-            rez = Polynomial::mod(rez, mod);
+            rez.mulmod_inplace(aa, mod);
         }
-        aa = Polynomial::mul(aa, aa);
-        aa = Polynomial::mod(aa, mod);
         power /= 2;
+        if (power > 0) {
+            aa.mulmod_inplace(aa, mod);
+        }
     }
     return rez;
 }
 
-ll binpow(ll a, ll b, ll mod) {
-    if (!b) return 1;
-    if (b % 2) {
-        return a * binpow(a, b - 1, mod) % mod;
-    } else {
-        ll res = binpow(a, b / 2, mod) % mod;
-        return res * res;
-    }
-}
-
-
 ll Polynomial::inverse(const ll& a, const ll& modp) {
-    return binpow(a, modp - 2, modp);
+    return FieldContext::get(modp).inverse(a);
 }
 
 
@@ -341,13 +717,16 @@ Polynomial Polynomial::normalize() const
     ll bl = coeff.back();
     ll ib = inverse(bl, modp);
 
-    vector<ll> v = coeff;
+    vector<ll> v = CoefficientPool::acquire(coeff.size());
+    v.assign(coeff.begin(), coeff.end());
 
-    for (int i = 0; i < v.size(); i++) {
-        v[i] = (v[i] * ib) % modp;
-    }
+    with_field(modp, [&](const auto& field) {
+        for (size_t i = 0; i < v.size(); i++) {
+            v[i] = field.mul(field.reduce(v[i]), ib);
+        }
+    });
 
-    return Polynomial(v, modp);
+    return Polynomial(std::move(v), modp);
 }
 
 
@@ -372,7 +751,7 @@ Polynomial Polynomial::get_random_polynomial(int max_degree, const ll& modq)
     long long poly_seed = std::chrono::steady_clock::now().time_since_epoch().count();
     std::mt19937 rng(poly_seed);
 
-    uniform_int_distribution<int> dist(0, modq - 1);
+    uniform_int_distribution<ll> dist(0, modq - 1);
     uniform_int_distribution<int> dist_degree(0, max_degree - 1);
 
     auto degree = dist_degree(rng) + 1;
@@ -380,7 +759,7 @@ Polynomial Polynomial::get_random_polynomial(int max_degree, const ll& modq)
     std::vector<ll> vr(degree + 1);
     vr[degree] = 1;
 
-    for (size_t i = 0; i < degree; i++)
+    for (int i = 0; i < degree; i++)
     {
         vr[i] = dist(rng);
     }
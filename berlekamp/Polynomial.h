@@ -6,9 +6,25 @@
 #include <cstdint>
 #include <string>
 #include <algorithm>
+#include <tuple>
 
 typedef long long ll;
 
+class PolynomialModulus;
+
+// Outcome of Polynomial::parse, position is the offset of the offending character on failure
+enum class ParseStatus {
+    Ok,
+    Empty,
+    UnexpectedCharacter,
+    DegreeTooLarge,
+};
+
+struct ParseResult {
+    ParseStatus status;
+    std::size_t position;
+};
+
 class Polynomial
 {
 private:
@@ -18,19 +34,61 @@ private:
 
     static std::pair<Polynomial, Polynomial> div_internal(const Polynomial& a, const Polynomial& b);
 
+    // Long division by b given the inverse of its leading coefficient
+    static std::pair<Polynomial, Polynomial> div_classic(const Polynomial& a, const Polynomial& b, const ll& lead_inverse);
+
+    // Long division in place: at becomes the remainder (not pruned), the quotient goes to quotient if it is given
+    static void remainder_classic(std::vector<ll>& at, const Polynomial& b, const ll& lead_inverse,
+                                  std::vector<ll>* quotient);
+
+    // Nonzero terms (i, b_i) of b below its leading one go to terms (if given) when there are few enough of
+    // them for the sparse long division, as with trinomial and pentanomial moduli
+    static bool sparse_terms(const Polynomial& b, std::vector<std::pair<int, ll>>* terms);
+
+    // remainder_classic for a b with the given sparse_terms, O(terms * (deg at - deg b))
+    static void remainder_sparse(std::vector<ll>& at, const Polynomial& b, const std::vector<std::pair<int, ll>>& terms,
+                                 const ll& lead_inverse, std::vector<ll>* quotient);
+
+    friend class PolynomialModulus;
+
+    // 2x2 polynomial matrix of Euclidean steps, defined in Polynomial.cpp
+    struct EuclidMatrix;
+
+    // Matrix M of Euclidean steps with (a', b') = M (a, b), where a', b' are the consecutive remainders
+    // of the sequence of (a, b) with deg a' >= ceil(deg a / 2) > deg b'
+    static EuclidMatrix half_gcd(const Polynomial& a, const Polynomial& b);
+
+    // Reduces (a, b) to (gcd, 0), accumulating the Euclidean steps into m if it is given
+    static Polynomial gcd_internal(Polynomial a, Polynomial b, EuclidMatrix* m);
+
+    Polynomial shift_right(int k) const;
+
 public:
     Polynomial(std::vector<ll> coeff, ll modp) : coeff(std::move(coeff)), modp(modp) {
         prune();
     };
 
-    explicit Polynomial() {}
+    explicit Polynomial() : modp(0) {}
+
+    // Parses text as Polynomial::parse does, throws std::invalid_argument on malformed input
+    Polynomial(const std::string& s, ll modp);
 
-    Polynomial(std::string s, ll modp);
+    // Copies and destruction go through CoefficientPool, moves just hand the buffer over
+    Polynomial(const Polynomial &polynomial);
 
-    Polynomial(const Polynomial &polynomial) : coeff(polynomial.coeff), modp(polynomial.modp) {};
+    Polynomial(Polynomial &&polynomial) noexcept = default;
 
     Polynomial &operator= (const Polynomial &polynomial) = default;
 
+    Polynomial &operator= (Polynomial &&polynomial) noexcept {
+        // The old buffer leaves with polynomial, which returns it to the pool
+        coeff.swap(polynomial.coeff);
+        modp = polynomial.modp;
+        return *this;
+    }
+
+    ~Polynomial();
+
     int get_degree() const;
 
     ll get_modp() const {
@@ -39,14 +97,28 @@ public:
 
     std::string to_string(const std::string& default_variable_name = "x") const;
 
+    // Writes the text of to_string to [first, last) and returns its end, or nullptr if it does not fit.
+    // No terminating zero is written.
+    char* format(char* first, char* last, const std::string& variable = "x") const;
+
+    // Single-pass parser for text such as "3x^5 - x^2 + 7" or "2 * x^3 + x^10": terms in any order, a sign
+    // before any term, spaces between tokens. Coefficients of any size are reduced mod modp, negative ones
+    // wrap around, terms with the same power add up. result is only written on success.
+    static ParseResult parse(const char* first, const char* last, ll modp, Polynomial& result, char variable = 'x');
+
+    // parse rejects powers above this limit with DegreeTooLarge rather than allocating them, 2^20 by default
+    static void set_parse_degree_limit(int degree);
+
+    static int get_parse_degree_limit();
+
     Polynomial diff() const;
 
     Polynomial get_pth_root() const;
 
     std::vector <ll> get_coeffs(int n) const {
         auto x = coeff;
-        while (x.size() < n) {
-            x.emplace_back(0);
+        if ((int) x.size() < n) {
+            x.resize(n, 0);
         }
         return x;
     }
@@ -63,6 +135,8 @@ public:
 
     static Polynomial mod(const Polynomial& a, const Polynomial& b);
 
+    static Polynomial mod(const Polynomial& a, const PolynomialModulus& b);
+
     Polynomial operator+(const Polynomial &rhs) const {
         return add(*this, rhs);
     }
@@ -82,6 +156,20 @@ public:
         return mod(*this, rhs);
     }
 
+    // In-place forms reuse the storage of *this where the result fits into it
+    Polynomial& operator+=(const Polynomial &rhs);
+
+    Polynomial& operator-=(const Polynomial &rhs);
+
+    Polynomial& operator*=(const Polynomial &rhs);
+
+    Polynomial& operator%=(const Polynomial &rhs);
+
+    Polynomial& operator%=(const PolynomialModulus &rhs);
+
+    // *this = *this * rhs mod m, rhs may be *this
+    void mulmod_inplace(const Polynomial& rhs, const PolynomialModulus& m);
+
     static Polynomial get_one(ll modp);
 
     static Polynomial get_random_polynomial(int max_degree, const ll& modq);
@@ -90,7 +178,17 @@ public:
 
     static Polynomial gcd(const Polynomial& a, const Polynomial& b);
 
-    Polynomial powmod(const Polynomial& a, ll b, const Polynomial& mod);
+    // Returns (g, s, t) with s * a + t * b = g = gcd(a, b)
+    static std::tuple<Polynomial, Polynomial, Polynomial> ext_gcd(const Polynomial& a, const Polynomial& b);
+
+    // gcd and ext_gcd switch from the Euclidean loop to half-GCD once both degrees reach this threshold
+    static void set_half_gcd_threshold(int degree);
+
+    static int get_half_gcd_threshold();
+
+    static Polynomial powmod(const Polynomial& a, ll b, const Polynomial& mod);
+
+    static Polynomial powmod(const Polynomial& a, ll b, const PolynomialModulus& mod);
 
     bool is_zero() const;
 
@@ -0,0 +1,209 @@
+#include "PolynomialFile.h"
+#include "Matrix.h"
+
+#include <cassert>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+    const char FILE_MAGIC[8] = {'B', 'R', 'L', 'K', 'P', 'O', 'L', 'Y'};
+    const uint32_t FILE_VERSION = 1;
+    const size_t HEADER_SIZE = 24;
+    const size_t RECORD_HEADER_SIZE = 24;
+
+    uint64_t load_le(const unsigned char* p, int width) {
+        uint64_t x = 0;
+        for (int i = width - 1; i >= 0; i--) {
+            x = (x << 8) | p[i];
+        }
+        return x;
+    }
+
+    void store_le(unsigned char* p, uint64_t x, int width) {
+        for (int i = 0; i < width; i++) {
+            p[i] = (unsigned char) (x >> (8 * i));
+        }
+    }
+
+    size_t padded(size_t bytes) {
+        return (bytes + 7) / 8 * 8;
+    }
+}
+
+ll PolynomialView::operator[](size_t i) const {
+    assert(i < count);
+    return (ll) load_le(data + i * width, width);
+}
+
+Polynomial PolynomialView::to_polynomial() const {
+    vector<ll> c(count);
+    for (size_t i = 0; i < count; i++) {
+        c[i] = (ll) load_le(data + i * width, width);
+    }
+    return Polynomial(move(c), modp);
+}
+
+PolynomialFileReader::~PolynomialFileReader() {
+    close();
+}
+
+void PolynomialFileReader::close() {
+    if (mapped) {
+        munmap(mapped, bytes);
+    }
+    mapped = nullptr;
+    bytes = 0;
+    polynomials.clear();
+    factorizations.clear();
+}
+
+bool PolynomialFileReader::open(const string& path) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t) HEADER_SIZE) {
+        ::close(fd);
+        return false;
+    }
+    bytes = (size_t) st.st_size;
+    mapped = mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        mapped = nullptr;
+        bytes = 0;
+        return false;
+    }
+    if (!index()) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool PolynomialFileReader::index() {
+    auto base = static_cast<const unsigned char*>(mapped);
+    if (memcmp(base, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0 || load_le(base + 8, 4) != FILE_VERSION) {
+        return false;
+    }
+    uint64_t count = load_le(base + 16, 8);
+    size_t pos = HEADER_SIZE;
+    // Factor records still owed to the last factorization record
+    uint64_t pending = 0;
+    for (uint64_t r = 0; r < count; r++) {
+        if (bytes - pos < RECORD_HEADER_SIZE) {
+            return false;
+        }
+        const unsigned char* header = base + pos;
+        ll modp = (ll) load_le(header, 8);
+        uint64_t n = load_le(header + 8, 8);
+        auto kind = (PolynomialRecord) header[16];
+        int width = header[17];
+        auto multiplicity = (uint32_t) load_le(header + 20, 4);
+        pos += RECORD_HEADER_SIZE;
+        if (kind == PolynomialRecord::Factorization) {
+            if (pending != 0) {
+                return false;
+            }
+            factorizations.emplace_back();
+            pending = n;
+            continue;
+        }
+        if ((kind != PolynomialRecord::Polynomial && kind != PolynomialRecord::Factor) ||
+            (kind == PolynomialRecord::Factor) != (pending != 0) || modp < 2 || width != Matrix::entry_width(modp) ||
+            n > (bytes - pos) / width) {
+            return false;
+        }
+        PolynomialView view(modp, (size_t) n, width, base + pos);
+        for (size_t i = 0; i < n; i++) {
+            if (view[i] < 0 || view[i] >= modp) {
+                return false;
+            }
+        }
+        pos += padded((size_t) n * width);
+        if (pos > bytes) {
+            return false;
+        }
+        if (kind == PolynomialRecord::Factor) {
+            factorizations.back().emplace_back(view, (int) multiplicity);
+            pending--;
+        } else {
+            polynomials.push_back(view);
+        }
+    }
+    return pending == 0;
+}
+
+PolynomialFileWriter::~PolynomialFileWriter() {
+    if (file) {
+        close();
+    }
+}
+
+bool PolynomialFileWriter::open(const string& path) {
+    if (file) {
+        close();
+    }
+    file = fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        return false;
+    }
+    records = 0;
+    unsigned char header[HEADER_SIZE] = {};
+    memcpy(header, FILE_MAGIC, sizeof(FILE_MAGIC));
+    store_le(header + 8, FILE_VERSION, 4);
+    ok = fwrite(header, 1, HEADER_SIZE, file) == HEADER_SIZE;
+    return ok;
+}
+
+void PolynomialFileWriter::write(const Polynomial& poly) {
+    write_record(PolynomialRecord::Polynomial, poly.get_modp(), &poly, 0, 0);
+}
+
+void PolynomialFileWriter::write(const vector<pair<Polynomial, int>>& factors) {
+    ll modp = factors.empty() ? 0 : factors[0].first.get_modp();
+    write_record(PolynomialRecord::Factorization, modp, nullptr, factors.size(), 0);
+    for (const auto& factor : factors) {
+        write_record(PolynomialRecord::Factor, factor.first.get_modp(), &factor.first, 0, (uint32_t) factor.second);
+    }
+}
+
+void PolynomialFileWriter::write_record(PolynomialRecord kind, ll modp, const Polynomial* poly, uint64_t count,
+                                        uint32_t multiplicity) {
+    assert(file);
+    int width = poly ? Matrix::entry_width(modp) : 0;
+    vector<ll> c = poly ? poly->get_coeffs(0) : vector<ll>();
+    if (poly) {
+        count = c.size();
+    }
+    vector<unsigned char> out(RECORD_HEADER_SIZE + padded(c.size() * width), 0);
+    store_le(out.data(), (uint64_t) modp, 8);
+    store_le(out.data() + 8, count, 8);
+    out[16] = (unsigned char) kind;
+    out[17] = (unsigned char) width;
+    store_le(out.data() + 20, multiplicity, 4);
+    for (size_t i = 0; i < c.size(); i++) {
+        store_le(out.data() + RECORD_HEADER_SIZE + i * width, (uint64_t) c[i], width);
+    }
+    ok = fwrite(out.data(), 1, out.size(), file) == out.size() && ok;
+    records++;
+}
+
+bool PolynomialFileWriter::close() {
+    if (file == nullptr) {
+        return false;
+    }
+    unsigned char count[8];
+    store_le(count, records, 8);
+    ok = fseek(file, 16, SEEK_SET) == 0 && fwrite(count, 1, 8, file) == 8 && ok;
+    ok = fclose(file) == 0 && ok;
+    file = nullptr;
+    return ok;
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Polynomial.h"
+
+// Binary polynomial files, version 1. Integers are little-endian.
+//   header:  8-byte magic "BRLKPOLY", u32 version, u32 reserved, u64 record count
+//   record:  u64 modp, u64 n, u8 kind, u8 width, u16 reserved, u32 multiplicity,
+//            then n coefficients of width bytes each, lowest power first, zero-padded to a multiple of 8 bytes
+// kind is a polynomial, a factor or a factorization. A factorization record carries no coefficients: n is the
+// number of factor records that follow it, each with its multiplicity. width is the narrowest of 1, 2, 4 or 8
+// bytes that holds every residue (Matrix::entry_width), so small fields take a fraction of the text size.
+enum class PolynomialRecord : std::uint8_t {
+    Polynomial = 0,
+    Factor = 1,
+    Factorization = 2,
+};
+
+// Coefficients of a polynomial record, read in place from the mapped file; valid while its reader is open
+class PolynomialView {
+public:
+    PolynomialView(ll modp, std::size_t count, int width, const unsigned char* data)
+        : modp(modp), count(count), width(width), data(data) {}
+
+    ll get_modp() const {
+        return modp;
+    }
+
+    // Number of stored coefficients, the degree is size() - 1 for a nonzero polynomial
+    std::size_t size() const {
+        return count;
+    }
+
+    ll operator[](std::size_t i) const;
+
+    Polynomial to_polynomial() const;
+
+private:
+    ll modp;
+    std::size_t count;
+    int width;
+    const unsigned char* data;
+};
+
+// Maps a polynomial file and indexes its records without copying any coefficients.
+// open checks the header, the record bounds and that every coefficient is below its modulus.
+class PolynomialFileReader {
+public:
+    typedef std::vector<std::pair<PolynomialView, int>> FactorizationView;
+
+    PolynomialFileReader() {}
+
+    PolynomialFileReader(const PolynomialFileReader&) = delete;
+
+    PolynomialFileReader& operator=(const PolynomialFileReader&) = delete;
+
+    ~PolynomialFileReader();
+
+    // False if the file is missing or malformed, the reader is then empty
+    bool open(const std::string& path);
+
+    void close();
+
+    // Polynomial records in file order
+    const std::vector<PolynomialView>& get_polynomials() const {
+        return polynomials;
+    }
+
+    // Factorization records in file order, each with its (factor, multiplicity) pairs
+    const std::vector<FactorizationView>& get_factorizations() const {
+        return factorizations;
+    }
+
+private:
+    bool index();
+
+    void* mapped = nullptr;
+    std::size_t bytes = 0;
+    std::vector<PolynomialView> polynomials;
+    std::vector<FactorizationView> factorizations;
+};
+
+// Writes polynomial files. The record count in the header is filled in by close.
+class PolynomialFileWriter {
+public:
+    PolynomialFileWriter() {}
+
+    PolynomialFileWriter(const PolynomialFileWriter&) = delete;
+
+    PolynomialFileWriter& operator=(const PolynomialFileWriter&) = delete;
+
+    ~PolynomialFileWriter();
+
+    bool open(const std::string& path);
+
+    void write(const Polynomial& poly);
+
+    // A factorization record followed by one factor record per entry, as berlekamp_factor returns them
+    void write(const std::vector<std::pair<Polynomial, int>>& factors);
+
+    // False if any write failed
+    bool close();
+
+private:
+    void write_record(PolynomialRecord kind, ll modp, const Polynomial* poly, std::uint64_t count,
+                      std::uint32_t multiplicity);
+
+    std::FILE* file = nullptr;
+    std::uint64_t records = 0;
+    bool ok = false;
+};
@@ -0,0 +1,106 @@
+#include "PolynomialModulus.h"
+#include "CoefficientPool.h"
+#include "Multiplication.h"
+#include "Stats.h"
+
+#include <algorithm>
+#include <cassert>
+
+using namespace std;
+
+namespace {
+    // Power series inverse of g modulo x^len, g[0] must be invertible
+    vector<ll> inverse_series(const vector<ll>& g, size_t len, ll modp) {
+        vector<ll> h{Polynomial::inverse(g[0], modp)};
+        size_t cur = 1;
+        while (cur < len) {
+            cur = min(cur * 2, len);
+            // h = h * (2 - g * h) mod x^cur
+            vector<ll> gl(g.begin(), g.begin() + min(cur, g.size()));
+            auto gh = multiply_coefficients(gl, h, modp);
+            gh.resize(cur, 0);
+            for (auto& c : gh) {
+                c = c == 0 ? 0 : modp - c;
+            }
+            gh[0] = (gh[0] + 2) % modp;
+            h = multiply_coefficients(h, gh, modp);
+            h.resize(cur, 0);
+        }
+        return h;
+    }
+}
+
+PolynomialModulus::PolynomialModulus(const Polynomial& f, int max_dividend_degree) : f(f), lead_inverse(0),
+    max_dividend_degree(max_dividend_degree), sparse(false) {
+    int n = f.get_degree();
+    assert(!f.is_zero());
+    lead_inverse = Polynomial::inverse(f.coeff.back(), f.get_modp());
+    if (this->max_dividend_degree < 0) {
+        this->max_dividend_degree = max(2 * n - 2, n);
+    }
+    sparse = Polynomial::sparse_terms(f, &sparse_terms);
+    int quotient_length = this->max_dividend_degree - n + 1;
+    if (!sparse && n >= NEWTON_DIVISION_THRESHOLD && quotient_length >= NEWTON_DIVISION_THRESHOLD) {
+        vector<ll> reversed(f.coeff.rbegin(), f.coeff.rend());
+        inverse_reversed = inverse_series(reversed, quotient_length, f.get_modp());
+    }
+}
+
+pair<Polynomial, Polynomial> PolynomialModulus::divide(const Polynomial& a) const {
+    assert(a.get_modp() == f.get_modp());
+    int n = f.get_degree();
+    int da = a.get_degree();
+    if (a.is_zero() || da < n) {
+        return { Polynomial(vector<ll>{}, get_modp()), a };
+    }
+    if (sparse) {
+        vector<ll> quotient;
+        vector<ll> at = CoefficientPool::acquire(a.coeff.size());
+        at.assign(a.coeff.begin(), a.coeff.end());
+        Polynomial::remainder_sparse(at, f, sparse_terms, lead_inverse, &quotient);
+        return { Polynomial(move(quotient), get_modp()), Polynomial(move(at), get_modp()) };
+    }
+    if (inverse_reversed.empty() || da > max_dividend_degree || da - n + 1 < NEWTON_DIVISION_THRESHOLD) {
+        return Polynomial::div_classic(a, f, lead_inverse);
+    }
+    count_operation(&OperationCounters::mod_calls, a.coeff.size() + f.coeff.size());
+
+    ll modp = get_modp();
+    size_t k = da - n + 1;
+    vector<ll> ra(a.coeff.rbegin(), a.coeff.rbegin() + k);
+    vector<ll> inv(inverse_reversed.begin(), inverse_reversed.begin() + k);
+    auto q = multiply_coefficients(ra, inv, modp);
+    q.resize(k, 0);
+    reverse(q.begin(), q.end());
+
+    auto qf = multiply_coefficients(q, f.coeff, modp);
+    vector<ll> r(a.coeff.begin(), a.coeff.begin() + n);
+    for (int i = 0; i < n && i < (int) qf.size(); i++) {
+        r[i] -= qf[i];
+        if (r[i] < 0) r[i] += modp;
+    }
+    return { Polynomial(q, modp), Polynomial(r, modp) };
+}
+
+Polynomial PolynomialModulus::reduce(const Polynomial& a) const {
+    return divide(a).second;
+}
+
+void PolynomialModulus::reduce_inplace(Polynomial& a) const {
+    assert(a.get_modp() == f.get_modp());
+    int da = a.get_degree();
+    if (a.is_zero() || da < f.get_degree()) {
+        return;
+    }
+    if (sparse) {
+        Polynomial::remainder_sparse(a.coeff, f, sparse_terms, lead_inverse, nullptr);
+        a.prune();
+        return;
+    }
+    if (inverse_reversed.empty() || da > max_dividend_degree || da - f.get_degree() + 1 < NEWTON_DIVISION_THRESHOLD) {
+        Polynomial::remainder_classic(a.coeff, f, lead_inverse, nullptr);
+        a.prune();
+        return;
+    }
+    a = divide(a).second;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <utility>
+#include <vector>
+
+#include "Polynomial.h"
+
+// Precomputed data for repeated reductions modulo a fixed polynomial f of degree n.
+// Small moduli are reduced by long division with a cached inverse of the leading coefficient.
+// From NEWTON_DIVISION_THRESHOLD on, rev(f)^-1 is precomputed by Newton iteration and a reduction
+// costs two multiplications: q = rev(rev(a) * rev(f)^-1) and r = a - q * f.
+// A sparse f, such as a trinomial or pentanomial, skips the Newton inverse at every degree: its long division
+// only touches the few nonzero terms and costs O(k (deg a - n)) for k terms.
+class PolynomialModulus {
+public:
+    // Dividends up to max_dividend_degree are handled by the fast path; -1 stands for 2n - 2,
+    // the degree of a product of two reduced polynomials
+    explicit PolynomialModulus(const Polynomial& f, int max_dividend_degree = -1);
+
+    const Polynomial& get_polynomial() const {
+        return f;
+    }
+
+    int get_degree() const {
+        return f.get_degree();
+    }
+
+    ll get_modp() const {
+        return f.get_modp();
+    }
+
+    std::pair<Polynomial, Polynomial> divide(const Polynomial& a) const;
+
+    bool is_sparse() const {
+        return sparse;
+    }
+
+    Polynomial reduce(const Polynomial& a) const;
+
+    // a = a mod f, long division runs in the storage of a
+    void reduce_inplace(Polynomial& a) const;
+
+    static const int NEWTON_DIVISION_THRESHOLD = 320;
+
+private:
+    Polynomial f;
+    ll lead_inverse;
+    int max_dividend_degree;
+    // rev(f)^-1 mod x^(max_dividend_degree - n + 1), empty if long division is used
+    std::vector<ll> inverse_reversed;
+    // Nonzero terms of f below the leading one when f is sparse
+    bool sparse;
+    std::vector<std::pair<int, ll>> sparse_terms;
+};
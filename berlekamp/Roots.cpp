@@ -0,0 +1,87 @@
+#include "Roots.h"
+#include "Modular.h"
+#include "PolynomialModulus.h"
+
+#include <algorithm>
+#include <cassert>
+#include <random>
+
+using namespace std;
+
+namespace {
+    // Up to this p the roots come from evaluating at every element, O(p deg g) without any gcd
+    const ll EVALUATION_LIMIT = 1 << 12;
+
+    vector<ll> roots_by_evaluation(const Polynomial& g) {
+        ll modp = g.get_modp();
+        int degree = g.get_degree();
+        auto c = g.get_coeffs(degree + 1);
+        vector<ll> roots;
+        with_field(modp, [&](const auto& field) {
+            for (ll x = 0; x < modp && (int) roots.size() < degree; x++) {
+                ull value = 0;
+                for (int i = degree; i >= 0; i--) {
+                    value = field.mul_add((ull) c[i], value, (ull) x);
+                }
+                if (value == 0) {
+                    roots.push_back(x);
+                }
+            }
+        });
+        return roots;
+    }
+
+    // gcd(g, (x + a)^((p-1)/2) - 1) holds the roots r with r + a a nonzero square, about half of them
+    void roots_by_splitting(const Polynomial& g, mt19937_64& rng, vector<ll>& roots) {
+        ll modp = g.get_modp();
+        if (g.get_degree() <= 0) {
+            return;
+        }
+        if (g.get_degree() == 1) {
+            auto c = g.get_coeffs(2);
+            roots.push_back(c[0] == 0 ? 0 : modp - c[0]);
+            return;
+        }
+        PolynomialModulus modulus(g);
+        uniform_int_distribution<ll> dist(0, modp - 1);
+        auto one = Polynomial::get_one(modp);
+        while (true) {
+            Polynomial shifted(vector<ll>{dist(rng), 1}, modp);
+            auto h = Polynomial::powmod(shifted, (modp - 1) / 2, modulus) - one;
+            auto d = Polynomial::gcd(g, h);
+            if (d.get_degree() > 0 && d.get_degree() < g.get_degree()) {
+                roots_by_splitting(d, rng, roots);
+                roots_by_splitting(Polynomial::div(g, d).normalize(), rng, roots);
+                return;
+            }
+        }
+    }
+}
+
+Polynomial linear_part(const Polynomial& poly) {
+    ll modp = poly.get_modp();
+    assert(!poly.is_zero());
+    if (poly.get_degree() <= 0) {
+        return Polynomial::get_one(modp);
+    }
+    PolynomialModulus modulus(poly);
+    Polynomial x(vector<ll>{0, 1}, modp);
+    auto xp = Polynomial::powmod(x, modp, modulus);
+    return Polynomial::gcd(poly, xp - x);
+}
+
+vector<ll> split_linear_part(const Polynomial& g, uint64_t seed) {
+    vector<ll> roots;
+    if (g.get_modp() <= EVALUATION_LIMIT) {
+        roots = roots_by_evaluation(g);
+    } else {
+        mt19937_64 rng(seed);
+        roots_by_splitting(g.normalize(), rng, roots);
+    }
+    sort(roots.begin(), roots.end());
+    return roots;
+}
+
+vector<ll> find_roots(const Polynomial& poly, uint64_t seed) {
+    return split_linear_part(linear_part(poly), seed);
+}
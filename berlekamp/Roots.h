@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Polynomial.h"
+
+// Distinct roots of poly in GF(p), in increasing order. The linear part g = gcd(f, x^p - x) is taken first,
+// then its roots are read off by evaluating g at every field element when p is small, or by
+// splitting g with gcd(g, (x + a)^((p-1)/2) - 1) for random a otherwise; seed fixes those draws.
+std::vector<ll> find_roots(const Polynomial& poly, std::uint64_t seed = 0);
+
+// gcd(poly, x^p - x), the monic product of the distinct linear factors of poly
+Polynomial linear_part(const Polynomial& poly);
+
+// Roots of a polynomial that is a product of distinct linear factors, such as linear_part returns
+std::vector<ll> split_linear_part(const Polynomial& g, std::uint64_t seed = 0);
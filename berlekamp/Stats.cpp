@@ -0,0 +1,31 @@
+#include "Stats.h"
+
+#include <algorithm>
+
+using namespace std;
+
+thread_local OperationCounters* OperationCounters::active = nullptr;
+
+void BerlekampStats::merge(const BerlekampStats& other) {
+    squarefree_seconds += other.squarefree_seconds;
+    distinct_degree_seconds += other.distinct_degree_seconds;
+    root_finding_seconds += other.root_finding_seconds;
+    q_matrix_seconds += other.q_matrix_seconds;
+    elimination_seconds += other.elimination_seconds;
+    splitting_seconds += other.splitting_seconds;
+    total_seconds += other.total_seconds;
+    mul_calls += other.mul_calls;
+    mod_calls += other.mod_calls;
+    gcd_calls += other.gcd_calls;
+    coefficient_ops += other.coefficient_ops;
+    peak_matrix_size = max(peak_matrix_size, other.peak_matrix_size);
+    nullity += other.nullity;
+    splitting_rounds += other.splitting_rounds;
+}
+
+void OperationCounters::store(BerlekampStats& stats) const {
+    stats.mul_calls = mul_calls.load(memory_order_relaxed);
+    stats.mod_calls = mod_calls.load(memory_order_relaxed);
+    stats.gcd_calls = gcd_calls.load(memory_order_relaxed);
+    stats.coefficient_ops = coefficient_ops.load(memory_order_relaxed);
+}
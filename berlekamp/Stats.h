@@ -0,0 +1,112 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// Filled in by berlekamp_factor when BerlekampOptions::stats points at it.
+// Stage times are summed over the squarefree parts, which may run concurrently.
+// The GF(2) backend (BerlekampOptions::gf2_backend) works on packed bits outside the counted
+// Polynomial arithmetic and fills only total_seconds and nullity, every other field stays zero.
+struct BerlekampStats {
+    double squarefree_seconds = 0;
+    // Only with BerlekampOptions::distinct_degree, method == KaltofenShoup or null_space == Wiedemann
+    double distinct_degree_seconds = 0;
+    // Only with BerlekampOptions::extract_roots
+    double root_finding_seconds = 0;
+    double q_matrix_seconds = 0;
+    double elimination_seconds = 0;
+    double splitting_seconds = 0;
+    double total_seconds = 0;
+
+    // Calls of Polynomial mul, division with remainder (also those inside gcd and powmod) and gcd
+    std::uint64_t mul_calls = 0;
+    std::uint64_t mod_calls = 0;
+    std::uint64_t gcd_calls = 0;
+    // Coefficients of the operands of the counted calls, a size-weighted measure of the arithmetic done
+    std::uint64_t coefficient_ops = 0;
+
+    // Largest Q matrix, as its number of rows
+    int peak_matrix_size = 0;
+    // Dimension of the Berlekamp subalgebra summed over the squarefree parts, i.e. the number of distinct irreducible factors
+    int nullity = 0;
+    int splitting_rounds = 0;
+
+    // Adds the counters and times of other, e.g. to aggregate a batch
+    void merge(const BerlekampStats& other);
+};
+
+// Operation counters the polynomial arithmetic adds to. Counting is off, at the cost of one
+// thread-local load per operation, unless a CountingScope is active on the thread.
+// ThreadPool tasks inherit the counters of the thread that started them.
+class OperationCounters {
+public:
+    std::atomic<std::uint64_t> mul_calls{0};
+    std::atomic<std::uint64_t> mod_calls{0};
+    std::atomic<std::uint64_t> gcd_calls{0};
+    std::atomic<std::uint64_t> coefficient_ops{0};
+
+    static OperationCounters* current() {
+        return active;
+    }
+
+    // Copies the counts into stats
+    void store(BerlekampStats& stats) const;
+
+private:
+    friend class CountingScope;
+
+    static thread_local OperationCounters* active;
+};
+
+// Directs the counting of this thread to counters until the scope ends, nullptr stops counting
+class CountingScope {
+public:
+    explicit CountingScope(OperationCounters* counters) : saved(OperationCounters::active) {
+        OperationCounters::active = counters;
+    }
+
+    ~CountingScope() {
+        OperationCounters::active = saved;
+    }
+
+    CountingScope(const CountingScope&) = delete;
+
+    CountingScope& operator=(const CountingScope&) = delete;
+
+private:
+    OperationCounters* saved;
+};
+
+inline void count_operation(std::atomic<std::uint64_t> OperationCounters::* calls, std::size_t coefficients) {
+    OperationCounters* counters = OperationCounters::current();
+    if (counters != nullptr) {
+        (counters->*calls).fetch_add(1, std::memory_order_relaxed);
+        counters->coefficient_ops.fetch_add(coefficients, std::memory_order_relaxed);
+    }
+}
+
+// Adds the wall time since construction to a seconds field when destroyed, or nothing without a target
+class StageTimer {
+public:
+    explicit StageTimer(double* target) : target(target) {
+        if (target != nullptr) {
+            start = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~StageTimer() {
+        if (target != nullptr) {
+            *target += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+    }
+
+    StageTimer(const StageTimer&) = delete;
+
+    StageTimer& operator=(const StageTimer&) = delete;
+
+private:
+    double* target;
+    std::chrono::steady_clock::time_point start;
+};
@@ -0,0 +1,136 @@
+#include "ThreadPool.h"
+#include "CoefficientPool.h"
+#include "Stats.h"
+
+#include <algorithm>
+#include <exception>
+
+using namespace std;
+
+namespace {
+    thread_local const ThreadPool* current_pool = nullptr;
+    thread_local int current_index = -1;
+}
+
+ThreadPool::ThreadPool(int workers_count) {
+    if (workers_count <= 0) {
+        workers_count = max(1, (int) thread::hardware_concurrency());
+    }
+    for (int i = 0; i < workers_count; i++) {
+        queues.emplace_back(new Queue());
+    }
+    for (int i = 0; i < workers_count; i++) {
+        workers.emplace_back([this, i] { worker_loop(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard<mutex> guard(sleep_lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::push(function<void()> task) {
+    size_t index = current_pool == this ? (size_t) current_index : next_queue++ % queues.size();
+    queued++;
+    {
+        lock_guard<mutex> guard(queues[index]->lock);
+        queues[index]->tasks.push_back(std::move(task));
+    }
+    {
+        // Pairs with the predicate check in worker_loop so the wake-up cannot be lost
+        lock_guard<mutex> guard(sleep_lock);
+    }
+    wake.notify_one();
+}
+
+bool ThreadPool::try_run_one(int self) {
+    function<void()> task;
+    if (self >= 0) {
+        lock_guard<mutex> guard(queues[self]->lock);
+        if (!queues[self]->tasks.empty()) {
+            task = std::move(queues[self]->tasks.back());
+            queues[self]->tasks.pop_back();
+        }
+    }
+    for (size_t k = 1; !task && k <= queues.size(); k++) {
+        size_t victim = ((size_t) max(self, 0) + k) % queues.size();
+        lock_guard<mutex> guard(queues[victim]->lock);
+        if (!queues[victim]->tasks.empty()) {
+            task = std::move(queues[victim]->tasks.front());
+            queues[victim]->tasks.pop_front();
+        }
+    }
+    if (!task) {
+        return false;
+    }
+    queued--;
+    task();
+    return true;
+}
+
+void ThreadPool::worker_loop(int index) {
+    current_pool = this;
+    current_index = index;
+    while (true) {
+        if (try_run_one(index)) {
+            continue;
+        }
+        unique_lock<mutex> guard(sleep_lock);
+        wake.wait(guard, [this] { return stopping || queued > 0; });
+        if (stopping && queued == 0) {
+            return;
+        }
+    }
+}
+
+void ThreadPool::parallel_for(size_t count, const function<void(size_t)>& body, size_t grain) {
+    if (count == 0) {
+        return;
+    }
+    grain = max<size_t>(grain, 1);
+    size_t chunks = (count + grain - 1) / grain;
+
+    struct Group {
+        atomic<size_t> remaining;
+        mutex error_lock;
+        exception_ptr error;
+    };
+    auto group = make_shared<Group>();
+    group->remaining = chunks;
+    OperationCounters* counters = OperationCounters::current();
+    bool pooled = CoefficientPool::active();
+
+    for (size_t c = 0; c < chunks; c++) {
+        push([group, &body, c, grain, count, counters, pooled] {
+            CountingScope counting(counters);
+            std::unique_ptr<CoefficientPool::Scope> pool_scope(pooled ? new CoefficientPool::Scope() : nullptr);
+            try {
+                for (size_t i = c * grain; i < min(count, (c + 1) * grain); i++) {
+                    body(i);
+                }
+            } catch (...) {
+                lock_guard<mutex> guard(group->error_lock);
+                if (!group->error) {
+                    group->error = current_exception();
+                }
+            }
+            group->remaining--;
+        });
+    }
+
+    int self = current_pool == this ? current_index : -1;
+    while (group->remaining > 0) {
+        if (!try_run_one(self)) {
+            this_thread::yield();
+        }
+    }
+    if (group->error) {
+        rethrow_exception(group->error);
+    }
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of workers with one task deque each. A worker pops its own deque from the back
+// and steals from the front of the others when it runs dry. parallel_for blocks the caller,
+// who keeps running queued tasks meanwhile, so nested parallel_for calls cannot deadlock.
+// Tasks count their operations into the OperationCounters of the caller, see Stats.h,
+// and pool their coefficient buffers when the caller does, see CoefficientPool.h.
+class ThreadPool {
+public:
+    // 0 workers means std::thread::hardware_concurrency()
+    explicit ThreadPool(int workers = 0);
+
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int get_size() const {
+        return (int) workers.size();
+    }
+
+    // Calls body(i) for every i in [0, count), grain consecutive indices per task.
+    // The first exception thrown by body is rethrown once all tasks have finished.
+    void parallel_for(std::size_t count, const std::function<void(std::size_t)>& body, std::size_t grain = 1);
+
+private:
+    struct Queue {
+        std::mutex lock;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void push(std::function<void()> task);
+
+    bool try_run_one(int self);
+
+    void worker_loop(int index);
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+    std::mutex sleep_lock;
+    std::condition_variable wake;
+    std::atomic<std::size_t> queued{0};
+    std::atomic<std::size_t> next_queue{0};
+    std::atomic<bool> stopping{false};
+};
+
+// Runs body over [0, count) on pool, or inline when there is no pool
+inline void parallel_for(ThreadPool* pool, std::size_t count, const std::function<void(std::size_t)>& body,
+                         std::size_t grain = 1) {
+    if (pool == nullptr || count <= 1) {
+        for (std::size_t i = 0; i < count; i++) {
+            body(i);
+        }
+        return;
+    }
+    pool->parallel_for(count, body, grain);
+}
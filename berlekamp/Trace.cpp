@@ -0,0 +1,49 @@
+#include "Trace.h"
+
+#include <iostream>
+#include <mutex>
+
+using namespace std;
+
+atomic<int> Trace::level{(int) TraceLevel::Off};
+
+namespace {
+    mutex sink_lock;
+
+    TraceSink& current_sink() {
+        static TraceSink sink;
+        return sink;
+    }
+
+    const char* level_name(TraceLevel level) {
+        switch (level) {
+            case TraceLevel::Info:
+                return "info";
+            case TraceLevel::Debug:
+                return "debug";
+            case TraceLevel::Verbose:
+                return "verbose";
+            default:
+                return "off";
+        }
+    }
+}
+
+void Trace::set_level(TraceLevel new_level) {
+    level.store((int) new_level, memory_order_relaxed);
+}
+
+void Trace::set_sink(TraceSink sink) {
+    lock_guard<mutex> guard(sink_lock);
+    current_sink() = move(sink);
+}
+
+// Serialized, so sinks need no locking of their own and parallel stages do not interleave lines
+void Trace::emit(TraceLevel at, const char* stage, const string& message) {
+    lock_guard<mutex> guard(sink_lock);
+    if (current_sink()) {
+        current_sink()(at, stage, message);
+    } else {
+        cerr << "[berlekamp " << level_name(at) << "] " << stage << ": " << message << '\n';
+    }
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <sstream>
+#include <string>
+
+// Diagnostics of the factorization stages. Messages go to a sink, stderr unless replaced,
+// and are only formatted when their level is enabled. The default level is Off, so the library is silent;
+// building with BERLEKAMP_DISABLE_TRACE removes the trace points altogether.
+enum class TraceLevel {
+    Off = 0,
+    // One line per stage: degrees, matrix sizes, number of factors
+    Info = 1,
+    // Intermediate polynomials
+    Debug = 2,
+    // Full matrices and bases, quadratic in the degree
+    Verbose = 3,
+};
+
+typedef std::function<void(TraceLevel level, const char* stage, const std::string& message)> TraceSink;
+
+class Trace {
+public:
+    static void set_level(TraceLevel level);
+
+    static TraceLevel get_level() {
+        return (TraceLevel) level.load(std::memory_order_relaxed);
+    }
+
+    static bool enabled(TraceLevel at) {
+        return (int) at <= level.load(std::memory_order_relaxed);
+    }
+
+    // An empty sink restores the default one writing to stderr
+    static void set_sink(TraceSink sink);
+
+    static void emit(TraceLevel at, const char* stage, const std::string& message);
+
+private:
+    static std::atomic<int> level;
+};
+
+#ifdef BERLEKAMP_DISABLE_TRACE
+#define BERLEKAMP_TRACE(level, stage, message) do { } while (0)
+#else
+// message is anything that can be streamed, e.g. "degree " << n
+#define BERLEKAMP_TRACE(level, stage, message) \
+    do { \
+        if (Trace::enabled(level)) { \
+            std::ostringstream trace_message_; \
+            trace_message_ << message; \
+            Trace::emit(level, stage, trace_message_.str()); \
+        } \
+    } while (0)
+#endif
@@ -0,0 +1,197 @@
+#include "Wiedemann.h"
+#include "PolynomialModulus.h"
+#include "Modular.h"
+#include "Trace.h"
+
+#include <cassert>
+
+using namespace std;
+
+vector<ll> berlekamp_massey(const vector<ll>& seq, ll modp) {
+    return with_field(modp, [&](const auto& field) {
+        // connection polynomials c(z) = 1 + c_1 z + ... + c_L z^L with seq[i] + sum_j c_j seq[i - j] = 0
+        vector<ull> c{1}, prev{1};
+        int length = 0;
+        int shift = 1;
+        ull prev_discrepancy = 1;
+        for (size_t i = 0; i < seq.size(); i++) {
+            ull discrepancy = (ull) seq[i];
+            for (int j = 1; j <= length; j++) {
+                discrepancy = field.mul_add(discrepancy, c[j], (ull) seq[i - j]);
+            }
+            if (discrepancy == 0) {
+                shift++;
+                continue;
+            }
+            ull coef = field.mul(discrepancy, field.inv(prev_discrepancy));
+            auto old = c;
+            if (c.size() < prev.size() + shift) {
+                c.resize(prev.size() + shift, 0);
+            }
+            for (size_t j = 0; j < prev.size(); j++) {
+                c[j + shift] = field.sub(c[j + shift], field.mul(coef, prev[j]));
+            }
+            if (2 * length <= (int) i) {
+                length = (int) i + 1 - length;
+                prev = move(old);
+                prev_discrepancy = discrepancy;
+                shift = 1;
+            } else {
+                shift++;
+            }
+        }
+        c.resize(length + 1, 0);
+        // The minimal polynomial is the reversal z^L c(1/z)
+        vector<ll> g(length + 1);
+        for (int j = 0; j <= length; j++) {
+            g[length - j] = (ll) c[j];
+        }
+        return g;
+    });
+}
+
+namespace {
+    Polynomial random_polynomial(int n, ll modp, mt19937_64& rng) {
+        uniform_int_distribution<ll> dist(0, modp - 1);
+        vector<ll> c(n);
+        for (auto& x : c) {
+            x = dist(rng);
+        }
+        return Polynomial(move(c), modp);
+    }
+
+    ll dot(const vector<ll>& u, const Polynomial& v, ll modp) {
+        auto c = v.get_coeffs((int) u.size());
+        return with_field(modp, [&](const auto& field) {
+            ull sum = 0;
+            for (size_t i = 0; i < u.size(); i++) {
+                sum = field.mul_add(sum, (ull) u[i], (ull) c[i]);
+            }
+            return (ll) sum;
+        });
+    }
+
+    // Linearly independent vectors of length n, row i is monic at column pivots[i] and zero at the earlier pivots
+    class EchelonBasis {
+    public:
+        EchelonBasis(int n, ll modp) : n(n), modp(modp) {}
+
+        // Reduces v against the rows and keeps it if something is left
+        bool insert(const Polynomial& v) {
+            auto c = v.get_coeffs(n);
+            with_field(modp, [&](const auto& field) {
+                for (size_t i = 0; i < rows.size(); i++) {
+                    ull factor = field.neg((ull) c[pivots[i]]);
+                    if (factor == 0) {
+                        continue;
+                    }
+                    for (int j = 0; j < n; j++) {
+                        c[j] = (ll) field.mul_add((ull) c[j], factor, (ull) rows[i][j]);
+                    }
+                }
+            });
+            int pivot = 0;
+            while (pivot < n && c[pivot] == 0) {
+                pivot++;
+            }
+            if (pivot == n) {
+                return false;
+            }
+            ll inverse = Polynomial::inverse(c[pivot], modp);
+            with_field(modp, [&](const auto& field) {
+                for (auto& x : c) {
+                    x = (ll) field.mul((ull) x, (ull) inverse);
+                }
+            });
+            rows.push_back(move(c));
+            pivots.push_back(pivot);
+            return true;
+        }
+
+        size_t size() const {
+            return rows.size();
+        }
+
+        vector<Polynomial> get_basis() const {
+            vector<Polynomial> basis;
+            for (const auto& row : rows) {
+                basis.emplace_back(row, modp);
+            }
+            return basis;
+        }
+
+    private:
+        int n;
+        ll modp;
+        vector<vector<ll>> rows;
+        vector<int> pivots;
+    };
+}
+
+vector<Polynomial> wiedemann_basis(const Polynomial& poly, int degree, mt19937_64& rng) {
+    ll modp = poly.get_modp();
+    int n = poly.get_degree();
+    assert(degree > 0 && n % degree == 0);
+    size_t nullity = n / degree;
+    EchelonBasis basis(n, modp);
+    basis.insert(Polynomial::get_one(modp));
+
+    // Plain powmod rather than a FrobeniusCache: its composition table would take O(deg poly ^ 1.5) memory
+    PolynomialModulus modulus(poly);
+    // v(x)^p = v(x^p) over GF(p), so this is v Q - v for the coefficient row vector v
+    auto apply = [&](const Polynomial& v) {
+        return Polynomial::powmod(v, modp, modulus) - v;
+    };
+
+    // h holds the minimal polynomial of A divided by lambda^k, empty until it is known
+    vector<ll> h;
+    int k = 0;
+    while (basis.size() < nullity) {
+        if (h.empty()) {
+            vector<ll> u = random_polynomial(n, modp, rng).get_coeffs(n);
+            Polynomial z = random_polynomial(n, modp, rng);
+            vector<ll> seq(2 * n);
+            for (int i = 0; i < 2 * n; i++) {
+                seq[i] = dot(u, z, modp);
+                z = apply(z);
+            }
+            auto g = berlekamp_massey(seq, modp);
+            // A is singular, a projection that hides the factor lambda is useless
+            k = 0;
+            while (k < (int) g.size() && g[k] == 0) {
+                k++;
+            }
+            if (k == 0) {
+                continue;
+            }
+            h.assign(g.begin() + k, g.end());
+            BERLEKAMP_TRACE(TraceLevel::Info, "wiedemann", "minimal polynomial of degree " << g.size() - 1
+                    << ", lambda^" << k);
+        }
+        auto y = random_polynomial(n, modp, rng);
+        Polynomial w = y * Polynomial(vector<ll>{h.back()}, modp);
+        for (int i = (int) h.size() - 2; i >= 0; i--) {
+            w = apply(w) + y * Polynomial(vector<ll>{h[i]}, modp);
+        }
+        if (w.is_zero()) {
+            continue;
+        }
+        // A^k kills the generalized kernel, otherwise the projection lost part of the minimal polynomial
+        bool found = false;
+        for (int t = 0; t < k; t++) {
+            auto next = apply(w);
+            if (next.is_zero()) {
+                found = true;
+                break;
+            }
+            w = move(next);
+        }
+        if (!found) {
+            h.clear();
+            continue;
+        }
+        basis.insert(w);
+    }
+    BERLEKAMP_TRACE(TraceLevel::Info, "null space", "dimension " << n << ", nullity " << basis.size());
+    return basis.get_basis();
+}
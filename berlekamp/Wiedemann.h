@@ -0,0 +1,20 @@
+#pragma once
+
+#include <random>
+#include <vector>
+
+#include "Polynomial.h"
+
+// Minimal polynomial of a linearly recurrent sequence over GF(modp) by Berlekamp-Massey:
+// the monic g of least degree L with sum_i g[i] * seq[j + i] = 0 for every j + L < seq.size().
+// seq needs 2L terms for g to be determined.
+std::vector<ll> berlekamp_massey(const std::vector<ll>& seq, ll modp);
+
+// Berlekamp basis of a squarefree poly whose irreducible factors all have the given degree, without the Q matrix.
+// A = Q^T - I is only applied as a black box, v -> v^p mod poly - v by powmod,
+// so memory stays O(deg poly) per vector instead of the O(deg poly ^ 2) of Q.
+// Wiedemann's method gives the minimal polynomial lambda^k h(lambda) of A from a projected Krylov sequence;
+// h(A) y for a random y lands in the generalized kernel of A, and the last nonzero vector of
+// h(A) y, A h(A) y, ... is a random element of the kernel. Samples are collected into echelon form,
+// starting from the constant 1, until there are deg poly / degree of them.
+std::vector<Polynomial> wiedemann_basis(const Polynomial& poly, int degree, std::mt19937_64& rng);
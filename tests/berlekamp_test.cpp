@@ -1,8 +1,28 @@
 #include "gtest/gtest.h"
 
+#include <algorithm>
+#include <cstdio>
+#include <random>
 #include <set>
+#include <unistd.h>
 #include "Polynomial.h"
 #include "Berlekamp.h"
+#include "GF2.h"
+#include "Matrix.h"
+#include "ThreadPool.h"
+#include "Modular.h"
+#include "CoefficientPool.h"
+#include "FieldContext.h"
+#include "Trace.h"
+#include "Roots.h"
+#include "Wiedemann.h"
+#include "Composition.h"
+#include "KaltofenShoup.h"
+#include "FactorCache.h"
+#include "PolynomialFile.h"
+#include "Multiplication.h"
+#include "PolynomialModulus.h"
+#include "Generators.h"
 
 using namespace std;
 
@@ -98,4 +118,848 @@ TEST(Berlekamp, many_factors) {
     auto result = berlekamp_factor(poly, 2);
 
     EXPECT_TRUE(check_answer(expected, result));
-}
\ No newline at end of file
+}
+
+TEST(Berlekamp, large_prime) {
+    ll modp = 10007;
+    std::vector<std::pair<Polynomial, int>> expected = {
+        {Polynomial("x+1", modp), 1},
+        {Polynomial("x+5", modp), 1},
+        {Polynomial("x^2+1", modp), 1},
+    };
+
+    Polynomial poly = Polynomial::get_one(modp);
+    for (const auto& f : expected) {
+        poly = poly * f.first;
+    }
+
+    auto result = berlekamp_factor(poly, modp);
+
+    EXPECT_TRUE(check_answer(expected, result));
+}
+
+
+TEST(Berlekamp, randomized_splitting) {
+    ll modp = 1000000007;
+    std::vector<std::pair<Polynomial, int>> expected = {
+        {Polynomial("x+1", modp), 1},
+        {Polynomial("x+5", modp), 2},
+        {Polynomial("x^2+1", modp), 1},
+        {Polynomial("x^2+3", modp), 1},
+    };
+
+    Polynomial poly = Polynomial::get_one(modp);
+    for (const auto& f : expected) {
+        for (int i = 0; i < f.second; i++) {
+            poly = poly * f.first;
+        }
+    }
+
+    BerlekampOptions options;
+    options.splitting = SplittingMode::Randomized;
+    options.seed = 42;
+
+    auto result = berlekamp_factor(poly, modp, options);
+    EXPECT_TRUE(check_answer(expected, result));
+    EXPECT_TRUE(result == berlekamp_factor(poly, modp, options));
+}
+
+
+TEST(Multiplication, engines_agree) {
+    std::mt19937_64 rng(7);
+    for (ll modp : {2LL, 37LL, 998244353LL, 1000000007LL}) {
+        std::uniform_int_distribution<ll> dist(0, modp - 1);
+        for (size_t n : {1, 31, 100, 700}) {
+            std::vector<ll> a(n), b(n + 13);
+            for (auto& c : a) c = dist(rng);
+            for (auto& c : b) c = dist(rng);
+            a.back() = b.back() = 1;
+
+            auto expected = multiply_schoolbook(a, b, modp);
+            EXPECT_EQ(expected, multiply_karatsuba(a, b, modp));
+            EXPECT_EQ(expected, multiply_ntt(a, b, modp));
+        }
+    }
+}
+
+
+TEST(PolynomialModulus, newton_division) {
+    ll modp = 1000000007;
+    std::mt19937_64 rng(11);
+    std::uniform_int_distribution<ll> dist(0, modp - 1);
+    auto random_poly = [&](int degree) {
+        std::vector<ll> c(degree + 1);
+        for (auto& x : c) x = dist(rng);
+        c.back() = 1 + dist(rng) % (modp - 1);
+        return Polynomial(c, modp);
+    };
+
+    for (int n : {5, 150, 700}) {
+        auto f = random_poly(n);
+        PolynomialModulus modulus(f);
+        for (int da : {n - 1, n + 3, 2 * n - 2}) {
+            auto a = random_poly(da);
+            auto qr = modulus.divide(a);
+            EXPECT_TRUE(qr.second.is_zero() || qr.second.get_degree() < n);
+            EXPECT_EQ(a, qr.first * f + qr.second);
+        }
+        auto big = random_poly(5 * n);
+        auto q = big / f;
+        EXPECT_EQ(big, q * f + big % f);
+    }
+}
+
+TEST(PolynomialModulus, sparse_division) {
+    for (ll modp : {2LL, 65537LL, 1000000007LL}) {
+        std::mt19937_64 rng(modp);
+        std::uniform_int_distribution<ll> dist(0, modp - 1);
+        for (int n : {7, 400, 5000}) {
+            // x^n + x^k + 1 and 3x^n + a x^k + b x^j + c
+            std::vector<ll> trinomial(n + 1, 0), pentanomial(n + 1, 0);
+            trinomial[n] = trinomial[n / 3] = trinomial[0] = 1;
+            pentanomial[n] = 3 % modp;
+            pentanomial[n - 1] = pentanomial[n / 2] = pentanomial[1] = 1 + dist(rng) % (modp - 1);
+            pentanomial[0] = 1;
+            for (const auto& c : {trinomial, pentanomial}) {
+                Polynomial f(c, modp);
+                PolynomialModulus modulus(f);
+                EXPECT_EQ(n > 7, modulus.is_sparse());
+                for (int da : {n - 1, n + 3, 2 * n - 2, 3 * n}) {
+                    std::vector<ll> ca(da + 1);
+                    for (auto& x : ca) x = dist(rng);
+                    Polynomial a(ca, modp);
+                    auto qr = modulus.divide(a);
+                    EXPECT_TRUE(qr.second.is_zero() || qr.second.get_degree() < n);
+                    EXPECT_EQ(a, qr.first * f + qr.second);
+                    EXPECT_EQ(qr.second, a % f);
+                    auto r = a;
+                    modulus.reduce_inplace(r);
+                    EXPECT_EQ(qr.second, r);
+                }
+            }
+        }
+    }
+    std::vector<ll> dense(9, 1);
+    EXPECT_FALSE(PolynomialModulus(Polynomial(dense, 3)).is_sparse());
+}
+
+
+TEST(Polynomial, parse_and_format) {
+    ll modp = 37;
+    auto parse = [&](const std::string& text, Polynomial& result) {
+        return Polynomial::parse(text.data(), text.data() + text.size(), modp, result);
+    };
+    Polynomial expected(std::vector<ll>{7, 0, 36, 0, 0, 3}, modp);
+    for (std::string text : {"3x^5-x^2+7", " 7 - x^2 + 3x^5 ", "-x ^ 2+3 * x^5+44", "x^5+x^2+7+2x^5-2x^2"}) {
+        Polynomial result;
+        auto status = parse(text, result);
+        EXPECT_EQ(ParseStatus::Ok, status.status) << text;
+        EXPECT_EQ(expected, result) << text;
+        EXPECT_EQ(modp, result.get_modp());
+    }
+    Polynomial big;
+    EXPECT_EQ(ParseStatus::Ok, parse("123456789012345678901234567890123456789x", big).status);
+    EXPECT_EQ(Polynomial(std::vector<ll>{0, 36}, modp), big);
+
+    Polynomial untouched = expected;
+    EXPECT_EQ(ParseStatus::Empty, parse("  ", untouched).status);
+    auto bad = parse("3x^2 + y", untouched);
+    EXPECT_EQ(ParseStatus::UnexpectedCharacter, bad.status);
+    EXPECT_EQ(7u, bad.position);
+    EXPECT_EQ(ParseStatus::UnexpectedCharacter, parse("3x^2 4x", untouched).status);
+    EXPECT_EQ(ParseStatus::UnexpectedCharacter, parse("x^+1", untouched).status);
+    EXPECT_EQ(ParseStatus::UnexpectedCharacter, parse("x+", untouched).status);
+    EXPECT_EQ(ParseStatus::DegreeTooLarge, parse("x^99999999999", untouched).status);
+    int limit = Polynomial::get_parse_degree_limit();
+    EXPECT_EQ(1 << 20, limit);
+    Polynomial at_limit;
+    EXPECT_EQ(ParseStatus::Ok, parse("x^" + std::to_string(limit), at_limit).status);
+    EXPECT_EQ(limit, at_limit.get_degree());
+    auto over = parse("2x^" + std::to_string(limit + 1), untouched);
+    EXPECT_EQ(ParseStatus::DegreeTooLarge, over.status);
+    EXPECT_EQ(3u, over.position);
+    Polynomial::set_parse_degree_limit(100);
+    EXPECT_EQ(ParseStatus::Ok, parse("x^100", at_limit).status);
+    EXPECT_EQ(ParseStatus::DegreeTooLarge, parse("x^101", untouched).status);
+    Polynomial::set_parse_degree_limit(limit);
+    EXPECT_EQ(expected, untouched);
+    EXPECT_THROW(Polynomial("x^2+*", modp), std::invalid_argument);
+
+    EXPECT_EQ("3x^5+36x^2+7", expected.to_string());
+    EXPECT_EQ("0", Polynomial(std::vector<ll>{}, modp).to_string());
+    EXPECT_EQ("t+1", Polynomial("x+1", modp).to_string("t"));
+    char buf[12];
+    char* end = expected.format(buf, buf + sizeof(buf));
+    ASSERT_NE(nullptr, end);
+    EXPECT_EQ("3x^5+36x^2+7", std::string(buf, end));
+    EXPECT_EQ(nullptr, expected.format(buf, buf + 11));
+}
+
+TEST(Polynomial, half_gcd) {
+    ll modp = 65537;
+    std::mt19937_64 rng(5);
+    std::uniform_int_distribution<ll> dist(0, modp - 1);
+    auto random_poly = [&](int degree) {
+        std::vector<ll> c(degree + 1);
+        for (auto& x : c) x = dist(rng);
+        c.back() = 1;
+        return Polynomial(c, modp);
+    };
+
+    int threshold = Polynomial::get_half_gcd_threshold();
+    for (int common : {0, 1, 40, 300}) {
+        auto g = random_poly(common);
+        auto a = g * random_poly(700);
+        auto b = g * random_poly(650);
+
+        Polynomial::set_half_gcd_threshold(1 << 30);
+        auto expected = Polynomial::gcd(a, b);
+        Polynomial::set_half_gcd_threshold(64);
+        EXPECT_EQ(expected, Polynomial::gcd(a, b));
+
+        Polynomial d, s, t;
+        std::tie(d, s, t) = Polynomial::ext_gcd(a, b);
+        EXPECT_EQ(expected, d);
+        EXPECT_EQ(d, s * a + t * b);
+    }
+    Polynomial::set_half_gcd_threshold(threshold);
+}
+
+
+TEST(Polynomial, inplace_operators) {
+    ll modp = 37;
+    std::mt19937_64 rng(17);
+    std::uniform_int_distribution<ll> dist(0, modp - 1);
+    auto random = [&](int degree) {
+        std::vector<ll> c(degree + 1);
+        for (auto& x : c) x = dist(rng);
+        c.back() = 1;
+        return Polynomial(c, modp);
+    };
+
+    CoefficientPool::Scope scope;
+    for (int degree : {0, 3, 40, 700}) {
+        Polynomial a = random(degree), b = random(degree / 2 + 1), f = random(degree + 5);
+        PolynomialModulus modulus(f);
+
+        Polynomial c = a;
+        c += b;
+        EXPECT_EQ(a + b, c);
+        c -= b;
+        EXPECT_EQ(a, c);
+        c -= a;
+        EXPECT_TRUE(c.is_zero());
+        c = a;
+        c *= b;
+        EXPECT_EQ(a * b, c);
+        c %= b;
+        EXPECT_EQ((a * b) % b, c);
+        c = a * b;
+        c %= modulus;
+        EXPECT_EQ((a * b) % f, c);
+        c = a;
+        c.mulmod_inplace(c, modulus);
+        EXPECT_EQ((a * a) % f, c);
+
+        Polynomial moved = std::move(c);
+        EXPECT_EQ((a * a) % f, moved);
+    }
+}
+
+TEST(Modular, barrett_matches_division) {
+    std::mt19937_64 rng(3);
+    for (ull m : {3ULL, 37ULL, 65537ULL, 1000000007ULL, 4294967291ULL}) {
+        BarrettField field(m);
+        for (int i = 0; i < 10000; i++) {
+            ull x = rng();
+            EXPECT_EQ(x % m, field.reduce(x));
+            ull a = x % m, b = rng() % m;
+            EXPECT_EQ((ull) ((u128) a * b % m), field.mul(a, b));
+        }
+        EXPECT_EQ(1ULL, field.mul(5, field.inv(5)));
+    }
+}
+
+
+TEST(Modular, montgomery_matches_division) {
+    std::mt19937_64 rng(4);
+    for (ull m : {4294967311ULL, 2305843009213693951ULL, 4611686018427387847ULL}) {
+        MontgomeryField field(m);
+        for (int i = 0; i < 10000; i++) {
+            ull x = rng();
+            EXPECT_EQ(x % m, field.reduce(x));
+            ull a = x % m, b = rng() % m;
+            EXPECT_EQ((ull) ((u128) a * b % m), field.mul(a, b));
+        }
+        EXPECT_EQ(1ULL, field.mul(5, field.inv(5)));
+    }
+}
+
+
+TEST(Berlekamp, wide_prime) {
+    ll modp = 2305843009213693951LL;
+    std::vector<std::pair<Polynomial, int>> expected = {
+        {Polynomial("x+3", modp), 1},
+        {Polynomial("x+2305843009213693000", modp), 2},
+        {Polynomial("x^2+1", modp), 1},
+    };
+
+    Polynomial poly = Polynomial::get_one(modp);
+    for (const auto& f : expected) {
+        for (int i = 0; i < f.second; i++) {
+            poly = poly * f.first;
+        }
+    }
+
+    auto result = berlekamp_factor(poly, modp);
+
+    EXPECT_TRUE(check_answer(expected, result));
+}
+
+
+TEST(GF2, matches_generic_arithmetic) {
+    std::mt19937_64 rng(8);
+    for (int n : {1, 63, 64, 200, 1000}) {
+        std::vector<ll> a(n + 1), b(n / 2 + 2);
+        for (auto& c : a) c = rng() & 1;
+        for (auto& c : b) c = rng() & 1;
+        a.back() = b.back() = 1;
+        Polynomial pa(a, 2), pb(b, 2);
+        GF2Polynomial ga(pa), gb(pb);
+
+        EXPECT_EQ(pa * pb, (ga * gb).to_polynomial());
+        EXPECT_EQ(pa + pb, (ga + gb).to_polynomial());
+        EXPECT_EQ(pa / pb, (ga / gb).to_polynomial());
+        EXPECT_EQ(pa % pb, (ga % gb).to_polynomial());
+        EXPECT_EQ(pa * pa, ga.square().to_polynomial());
+        EXPECT_EQ(ga, (ga * ga).get_sqrt());
+    }
+}
+
+
+TEST(GF2, matches_generic_factorization) {
+    Polynomial poly = Polynomial("x^11+x^10+x^9+x^8+x^6+x^5+1", 2) * Polynomial("x^63+1", 2) * Polynomial("x^14+x^10+x^9+x^8+x^7+x^6+x^3+x^2+1", 2);
+
+    BerlekampOptions generic;
+    generic.gf2_backend = false;
+
+    EXPECT_TRUE(check_answer(berlekamp_factor(poly, 2, generic), berlekamp_factor(poly, 2)));
+}
+
+
+TEST(Matrix, row_echelon_form) {
+    std::mt19937_64 rng(9);
+    for (ll modp : {3LL, 251LL, 65521LL, 65537LL, 4294967291LL, 2305843009213693951LL}) {
+        int n = 150;
+        Matrix m(n, modp), expected(n, modp);
+        for (int i = 0; i < n; i++) {
+            for (int j = 0; j < n; j++) {
+                // Every third row repeats the previous one, so the rank is deficient
+                ll v = i % 3 == 2 ? m.get(i - 1, j) : (ll) (rng() % modp);
+                m.set(i, j, v);
+                expected.set(i, j, v);
+            }
+        }
+
+        // Reference Gauss-Jordan through the element accessors
+        int r = 0;
+        for (int lead = 0; lead < n && r < n; lead++) {
+            int i = r;
+            while (i < n && expected.get(i, lead) == 0) i++;
+            if (i == n) continue;
+            expected.swap_rows(i, r);
+            expected.divide_row(r, expected.get(r, lead));
+            for (i = 0; i < n; i++) {
+                if (i != r) expected.sub_rows(i, r, expected.get(i, lead));
+            }
+            r++;
+        }
+
+        // Once through the 64-bit working copy and once through the panel kernel on the compact entries
+        int threshold = Matrix::get_compact_elimination_threshold();
+        for (int compact_from : {n + 1, 0}) {
+            Matrix::set_compact_elimination_threshold(compact_from);
+            Matrix reduced = m;
+            reduced.row_echelon_form();
+            for (int i = 0; i < n; i++) {
+                for (int j = 0; j < n; j++) {
+                    ASSERT_EQ(expected.get(i, j), reduced.get(i, j));
+                }
+            }
+        }
+        Matrix::set_compact_elimination_threshold(threshold);
+    }
+    EXPECT_EQ(1, Matrix(1, 251).get_entry_width());
+    EXPECT_EQ(2, Matrix(1, 65521).get_entry_width());
+    EXPECT_EQ(4, Matrix(1, 65537).get_entry_width());
+    EXPECT_EQ(8, Matrix(1, 2305843009213693951LL).get_entry_width());
+}
+
+
+TEST(Berlekamp, parallel_matches_sequential) {
+    ll modp = 37;
+    Polynomial poly = Polynomial("x^24+10x^23+32x^22+28x^21+13x^20+13x^19+17x^18+12x^17+29x^16+16x^15+13x^14+30x^13+31x^12+31x^11+2x^10+15x^9+5x^8+15x^7+3x^6+10x^5+18x^4+4x^3+6x^2+36x+19", modp);
+    poly = poly * Polynomial("x^2+1", modp) * Polynomial("x^2+1", modp) * Polynomial("x+3", modp);
+
+    for (auto mode : {SplittingMode::Exhaustive, SplittingMode::Randomized}) {
+        BerlekampOptions options;
+        options.splitting = mode;
+        auto expected = berlekamp_factor(poly, modp, options);
+
+        options.threads = 4;
+        EXPECT_EQ(expected, berlekamp_factor(poly, modp, options));
+    }
+}
+
+
+TEST(Berlekamp, batch_matches_single) {
+    ll modp = 101;
+    std::mt19937_64 rng(13);
+    std::uniform_int_distribution<ll> dist(0, modp - 1);
+    auto random_monic = [&](int degree) {
+        std::vector<ll> c(degree + 1);
+        for (auto& x : c) x = dist(rng);
+        c.back() = 1;
+        return Polynomial(c, modp);
+    };
+    std::vector<Polynomial> polys;
+    for (int i = 0; i < 40; i++) {
+        Polynomial b = random_monic(1 + i % 5);
+        polys.push_back(random_monic(1 + i % 7) * b * b);
+    }
+
+    BerlekampOptions options;
+    options.threads = 3;
+    auto batch = berlekamp_factor_batch(polys, modp, options);
+    ASSERT_EQ(polys.size(), batch.size());
+    for (size_t i = 0; i < polys.size(); i++) {
+        EXPECT_EQ(berlekamp_factor(polys[i], modp), batch[i]);
+    }
+}
+
+TEST(FieldContext, inverse_table) {
+    for (ll modp : {2LL, 101LL, 65537LL, 1000000007LL, (1LL << 61) - 1}) {
+        const FieldContext& context = FieldContext::get(modp);
+        EXPECT_EQ(&context, &FieldContext::get(modp));
+        for (ll a = 1; a < std::min<ll>(modp, 2000); a++) {
+            EXPECT_EQ(1, (ll) ((u128) a * context.inverse(a) % modp));
+        }
+    }
+}
+
+TEST(Berlekamp, distinct_degree) {
+    ll modp = 7;
+    // Irreducible factors of degrees 1, 1, 2, 3 and 3
+    std::vector<Polynomial> irreducible{
+        Polynomial("x+1", modp), Polynomial("x+2", modp), Polynomial("x^2+1", modp),
+        Polynomial("x^3+3", modp), Polynomial("x^3+x+1", modp)};
+    Polynomial poly = Polynomial::get_one(modp);
+    for (const auto& f : irreducible) {
+        poly = poly * f;
+    }
+
+    auto pieces = distinct_degree_decompose(poly);
+    ASSERT_EQ(3u, pieces.size());
+    EXPECT_EQ(irreducible[0] * irreducible[1], pieces[0].first);
+    EXPECT_EQ(1, pieces[0].second);
+    EXPECT_EQ(irreducible[2], pieces[1].first);
+    EXPECT_EQ(2, pieces[1].second);
+    EXPECT_EQ(irreducible[3] * irreducible[4], pieces[2].first);
+    EXPECT_EQ(3, pieces[2].second);
+
+    poly = poly * Polynomial("x^2+1", modp);
+    BerlekampOptions options;
+    options.distinct_degree = true;
+    EXPECT_TRUE(check_answer(berlekamp_factor(poly, modp), berlekamp_factor(poly, modp, options)));
+}
+
+TEST(Berlekamp, wiedemann) {
+    // s_i + s_{i-1} + s_{i-2} = 0 mod 5 has the minimal polynomial z^2 + z + 1
+    EXPECT_EQ((std::vector<ll>{1, 1, 1}), berlekamp_massey({1, 2, 2, 1, 2, 2}, 5));
+    EXPECT_EQ((std::vector<ll>{0, 1}), berlekamp_massey({3, 0, 0, 0}, 5));
+
+    BerlekampOptions dense;
+    dense.gf2_backend = false;
+    BerlekampOptions wiedemann = dense;
+    wiedemann.null_space = NullSpaceMethod::Wiedemann;
+    // Degree 3 factors over GF(3) and degree 2 factors over GF(2) make Q - I non-diagonalizable
+    for (ll modp : {2LL, 3LL, 37LL, 65537LL, 1000000007LL}) {
+        std::mt19937_64 rng(modp);
+        std::uniform_int_distribution<ll> dist(0, modp - 1);
+        for (int t = 0; t < 8; t++) {
+            Polynomial poly = Polynomial::get_one(modp);
+            for (int i = 0; i < 5; i++) {
+                std::vector<ll> c(2 + (t + i) % 4);
+                for (auto& x : c) x = dist(rng);
+                c.back() = 1;
+                poly = poly * Polynomial(c, modp);
+            }
+            EXPECT_TRUE(check_answer(berlekamp_factor(poly, modp, dense), berlekamp_factor(poly, modp, wiedemann)));
+        }
+    }
+}
+
+TEST(Composition, matches_horner) {
+    for (ll modp : {2LL, 37LL, 998244353LL, 2305843009213693951LL}) {
+        std::mt19937_64 rng(modp);
+        std::uniform_int_distribution<ll> dist(0, modp - 1);
+        for (int n : {1, 5, 40, 130}) {
+            std::vector<ll> c(n + 1), g(2 * n), h(n + 3);
+            for (auto& x : c) x = dist(rng);
+            for (auto& x : g) x = dist(rng);
+            for (auto& x : h) x = dist(rng);
+            c[n] = 1;
+            PolynomialModulus modulus(Polynomial(c, modp));
+            Polynomial inner(h, modp);
+            Polynomial expected(std::vector<ll>{}, modp);
+            for (int i = 2 * n - 1; i >= 0; i--) {
+                expected = Polynomial::mod(expected * inner + Polynomial(std::vector<ll>{g[i]}, modp), modulus);
+            }
+            EXPECT_EQ(expected, ModularComposition(inner, modulus).compose(Polynomial(g, modp)));
+
+            FrobeniusCache frobenius(modulus);
+            Polynomial x(std::vector<ll>{0, 1}, modp);
+            EXPECT_EQ(Polynomial::powmod(x, modp, modulus), frobenius.power(1));
+            EXPECT_EQ(Polynomial::powmod(frobenius.power(2), modp, modulus), frobenius.power(3));
+            EXPECT_EQ(Polynomial::powmod(inner, modp, modulus), frobenius.apply(inner));
+        }
+    }
+}
+
+TEST(Berlekamp, kaltofen_shoup) {
+    BerlekampOptions berlekamp;
+    berlekamp.gf2_backend = false;
+    BerlekampOptions kaltofen_shoup = berlekamp;
+    kaltofen_shoup.method = FactorizationMethod::KaltofenShoup;
+    for (ll modp : {2LL, 3LL, 37LL, 65537LL, 1000000007LL}) {
+        std::mt19937_64 rng(modp);
+        std::uniform_int_distribution<ll> dist(0, modp - 1);
+        for (int t = 0; t < 8; t++) {
+            Polynomial poly = Polynomial::get_one(modp);
+            for (int i = 0; i < 6; i++) {
+                std::vector<ll> c(2 + (t + 3 * i) % 7);
+                for (auto& x : c) x = dist(rng);
+                c.back() = 1;
+                poly = poly * Polynomial(c, modp);
+            }
+            for (const auto& part : squarefree_decompose(poly)) {
+                EXPECT_EQ(distinct_degree_decompose(part.first), distinct_degree_decompose_bsgs(part.first));
+            }
+            EXPECT_TRUE(check_answer(berlekamp_factor(poly, modp, berlekamp),
+                                     berlekamp_factor(poly, modp, kaltofen_shoup)));
+        }
+    }
+}
+
+TEST(FactorCache, lru_and_persistence) {
+    FactorCache cache(2);
+    BerlekampOptions options;
+    options.cache = &cache;
+    Polynomial a("x^4+1", 37), b("x^3+x+1", 37), c("x^4+1", 41);
+
+    auto expected = berlekamp_factor(a, 37);
+    EXPECT_TRUE(check_answer(expected, berlekamp_factor(a, 37, options)));
+    EXPECT_TRUE(check_answer(expected, berlekamp_factor(a, 37, options)));
+    EXPECT_EQ(1u, cache.get_hits());
+    EXPECT_EQ(1u, cache.get_misses());
+
+    // Same coefficients over another field are a different key; b then evicts the older entry c, not a
+    berlekamp_factor(c, 41, options);
+    berlekamp_factor(a, 37, options);
+    berlekamp_factor(b, 37, options);
+    EXPECT_EQ(2u, cache.size());
+    FactorCache::Factorization result;
+    EXPECT_TRUE(cache.lookup(a, result));
+    EXPECT_TRUE(check_answer(expected, result));
+    EXPECT_FALSE(cache.lookup(c, result));
+
+    std::string path = ::testing::TempDir() + "berlekamp_factor_cache.bin";
+    ASSERT_TRUE(cache.save(path));
+    FactorCache restored(8);
+    ASSERT_TRUE(restored.load(path));
+    EXPECT_EQ(2u, restored.size());
+    EXPECT_TRUE(restored.lookup(b, result));
+    EXPECT_TRUE(check_answer(berlekamp_factor(b, 37), result));
+    EXPECT_EQ(37, result[0].first.get_modp());
+
+    // A truncated file is rejected
+    FILE* file = fopen(path.c_str(), "r+b");
+    ASSERT_NE(nullptr, file);
+    ASSERT_EQ(0, ftruncate(fileno(file), 5 * sizeof(std::uint64_t)));
+    fclose(file);
+    FactorCache broken(8);
+    EXPECT_FALSE(broken.load(path));
+    EXPECT_FALSE(FactorCache(8).load(path + ".missing"));
+    remove(path.c_str());
+}
+
+TEST(FactorCache, rejects_bad_input) {
+    EXPECT_THROW(FactorCache(0), std::invalid_argument);
+
+    // A polynomial over GF(41) factored over GF(37) would be stored under the key of GF(41)
+    FactorCache cache(2);
+    BerlekampOptions options;
+    options.cache = &cache;
+    EXPECT_THROW(berlekamp_factor(Polynomial("x^4+1", 41), 37, options), std::invalid_argument);
+    EXPECT_EQ(0u, cache.size());
+}
+
+TEST(PolynomialFile, round_trip) {
+    std::string path = ::testing::TempDir() + "berlekamp_polynomials.bin";
+    std::vector<Polynomial> polys;
+    for (ll modp : {2LL, 251LL, 65537LL, 1000000007LL, 2305843009213693951LL}) {
+        std::mt19937_64 rng(modp);
+        std::uniform_int_distribution<ll> dist(0, modp - 1);
+        for (int n : {1, 3, 40}) {
+            std::vector<ll> c(n);
+            for (auto& x : c) x = dist(rng);
+            c.back() = 1;
+            polys.emplace_back(c, modp);
+        }
+    }
+    polys.emplace_back(std::vector<ll>{}, 7);
+    Polynomial poly("x^6+x^4+2x+5", 37);
+    auto factors = berlekamp_factor(poly, 37);
+
+    PolynomialFileWriter writer;
+    ASSERT_TRUE(writer.open(path));
+    for (const auto& p : polys) {
+        writer.write(p);
+    }
+    writer.write(factors);
+    ASSERT_TRUE(writer.close());
+
+    PolynomialFileReader reader;
+    ASSERT_TRUE(reader.open(path));
+    ASSERT_EQ(polys.size(), reader.get_polynomials().size());
+    for (size_t i = 0; i < polys.size(); i++) {
+        const auto& view = reader.get_polynomials()[i];
+        EXPECT_EQ(polys[i].get_modp(), view.get_modp());
+        EXPECT_EQ(polys[i], view.to_polynomial());
+        if (view.size() > 0) {
+            EXPECT_EQ(polys[i].get_coeffs(0)[0], view[0]);
+        }
+    }
+    ASSERT_EQ(1u, reader.get_factorizations().size());
+    std::vector<std::pair<Polynomial, int>> restored;
+    for (const auto& factor : reader.get_factorizations()[0]) {
+        restored.emplace_back(factor.first.to_polynomial(), factor.second);
+    }
+    EXPECT_TRUE(check_answer(factors, restored));
+    reader.close();
+
+    // A coefficient of 5 in a GF(2) record and a wrong magic are each rejected on an otherwise valid file
+    FILE* file = fopen(path.c_str(), "r+b");
+    ASSERT_NE(nullptr, file);
+    fseek(file, 24 + 24, SEEK_SET);
+    int coefficient = fgetc(file);
+    fseek(file, 24 + 24, SEEK_SET);
+    fputc(5, file);
+    fclose(file);
+    EXPECT_FALSE(reader.open(path));
+    file = fopen(path.c_str(), "r+b");
+    fseek(file, 24 + 24, SEEK_SET);
+    fputc(coefficient, file);
+    fclose(file);
+    ASSERT_TRUE(reader.open(path));
+    reader.close();
+    file = fopen(path.c_str(), "r+b");
+    fputc('X', file);
+    fclose(file);
+    EXPECT_FALSE(reader.open(path));
+    EXPECT_TRUE(reader.get_polynomials().empty());
+    remove(path.c_str());
+}
+
+TEST(Berlekamp, is_irreducible) {
+    EXPECT_TRUE(is_irreducible(Polynomial("x^2+1", 7)));
+    EXPECT_TRUE(is_irreducible(Polynomial("3x+1", 7)));
+    EXPECT_FALSE(is_irreducible(Polynomial("x^2+1", 5)));
+    EXPECT_FALSE(is_irreducible(Polynomial("5", 7)));
+    EXPECT_FALSE(is_irreducible(Polynomial("x^2+1", 7) * Polynomial("x^2+1", 7)));
+    EXPECT_FALSE(is_irreducible(Polynomial("x^3+3", 7) * Polynomial("x^3+x+1", 7)));
+
+    // Agrees with the factorization on random inputs
+    for (ll modp : {2LL, 3LL, 37LL}) {
+        std::mt19937_64 rng(modp);
+        std::uniform_int_distribution<ll> dist(0, modp - 1);
+        for (int t = 0; t < 30; t++) {
+            std::vector<ll> c(2 + t % 9);
+            for (auto& x : c) x = dist(rng);
+            c.back() = 1;
+            Polynomial poly(c, modp);
+            auto factors = berlekamp_factor(poly, modp);
+            bool expected = factors.size() == 1 && factors[0].second == 1 && factors[0].first.get_degree() == poly.get_degree();
+            EXPECT_EQ(expected, is_irreducible(poly));
+        }
+    }
+}
+
+TEST(Roots, find_roots) {
+    for (ll modp : {5LL, 37LL, 1000003LL, (1LL << 61) - 1}) {
+        std::vector<ll> roots{0, 1, 2, 4};
+        Polynomial poly = Polynomial("x^2+x+2", modp) * Polynomial("x^3+x+4", modp);
+        for (ll r : roots) {
+            poly = poly * Polynomial(std::vector<ll>{(modp - r) % modp, 1}, modp);
+        }
+        // A repeated root is reported once
+        poly = poly * Polynomial(std::vector<ll>{modp - 4, 1}, modp);
+
+        auto found = find_roots(poly);
+        // The extra factors may have roots of their own, so check every root against evaluation
+        for (ll r : roots) {
+            EXPECT_TRUE(std::binary_search(found.begin(), found.end(), r));
+        }
+        for (ll r : found) {
+            EXPECT_TRUE((poly % Polynomial(std::vector<ll>{(modp - r) % modp, 1}, modp)).is_zero());
+        }
+        EXPECT_TRUE(std::is_sorted(found.begin(), found.end()));
+        EXPECT_EQ((int) found.size(), linear_part(poly).get_degree());
+    }
+}
+
+TEST(Berlekamp, extract_roots) {
+    ll modp = 101;
+    Polynomial poly = Polynomial("x^3+x+1", modp) * Polynomial("x^2+3", modp);
+    for (ll r : {3, 7, 50, 99}) {
+        poly = poly * Polynomial(std::vector<ll>{modp - r, 1}, modp);
+    }
+    poly = poly * Polynomial("x+3", modp) * Polynomial("x+3", modp);
+    BerlekampOptions options;
+    options.extract_roots = true;
+    EXPECT_TRUE(check_answer(berlekamp_factor(poly, modp), berlekamp_factor(poly, modp, options)));
+    options.distinct_degree = true;
+    EXPECT_TRUE(check_answer(berlekamp_factor(poly, modp), berlekamp_factor(poly, modp, options)));
+}
+
+TEST(Berlekamp, stats) {
+    ll modp = 37;
+    Polynomial poly = Polynomial("x^5+3x^2+x+7", modp) * Polynomial("x^2+1", modp) * Polynomial("x^2+1", modp);
+    BerlekampStats stats;
+    BerlekampOptions options;
+    options.stats = &stats;
+    options.threads = 2;
+    auto result = berlekamp_factor(poly, modp, options);
+
+    EXPECT_GT(stats.total_seconds, 0);
+    EXPECT_GT(stats.mul_calls, 0u);
+    EXPECT_GT(stats.mod_calls, 0u);
+    EXPECT_GT(stats.gcd_calls, 0u);
+    EXPECT_GT(stats.coefficient_ops, 0u);
+    EXPECT_EQ((int) result.size(), stats.nullity);
+    // The squarefree part of multiplicity one, x^5+3x^2+x+7, has the largest Q matrix
+    EXPECT_EQ(5, stats.peak_matrix_size);
+    EXPECT_GE(stats.splitting_rounds, 1);
+    EXPECT_EQ(0, stats.distinct_degree_seconds);
+
+    // Both run the distinct-degree stage without BerlekampOptions::distinct_degree
+    options.method = FactorizationMethod::KaltofenShoup;
+    berlekamp_factor(poly, modp, options);
+    EXPECT_GT(stats.distinct_degree_seconds, 0);
+    options.method = FactorizationMethod::Berlekamp;
+    options.null_space = NullSpaceMethod::Wiedemann;
+    berlekamp_factor(poly, modp, options);
+    EXPECT_GT(stats.distinct_degree_seconds, 0);
+}
+
+TEST(Berlekamp, stats_gf2) {
+    ll modp = 2;
+    Polynomial poly = Polynomial("x^5+x^2+1", modp) * Polynomial("x^2+x+1", modp) * Polynomial("x^2+x+1", modp);
+    BerlekampStats stats;
+    BerlekampOptions options;
+    options.stats = &stats;
+    auto result = berlekamp_factor(poly, modp, options);
+
+    // The GF(2) backend fills only the total time and the nullity
+    EXPECT_GT(stats.total_seconds, 0);
+    EXPECT_EQ((int) result.size(), stats.nullity);
+    EXPECT_EQ(0, stats.squarefree_seconds);
+    EXPECT_EQ(0, stats.q_matrix_seconds);
+    EXPECT_EQ(0u, stats.mul_calls);
+    EXPECT_EQ(0u, stats.gcd_calls);
+    EXPECT_EQ(0, stats.peak_matrix_size);
+    EXPECT_EQ(0, stats.splitting_rounds);
+}
+
+TEST(Berlekamp, gf2_explicit_method) {
+    ll modp = 2;
+    Polynomial poly = Polynomial("x^5+x^2+1", modp) * Polynomial("x^3+x+1", modp) * Polynomial("x+1", modp);
+    auto expected = berlekamp_factor(poly, modp);
+    BerlekampStats stats;
+    BerlekampOptions options;
+    options.stats = &stats;
+    options.method = FactorizationMethod::KaltofenShoup;
+    EXPECT_TRUE(check_answer(expected, berlekamp_factor(poly, modp, options)));
+    // The GF(2) backend counts no Polynomial operations, so these prove it was bypassed
+    EXPECT_GT(stats.mul_calls, 0u);
+    options.method = FactorizationMethod::Berlekamp;
+    options.null_space = NullSpaceMethod::Wiedemann;
+    EXPECT_TRUE(check_answer(expected, berlekamp_factor(poly, modp, options)));
+    EXPECT_GT(stats.mul_calls, 0u);
+    options.null_space = NullSpaceMethod::Dense;
+    options.extract_roots = true;
+    EXPECT_TRUE(check_answer(expected, berlekamp_factor(poly, modp, options)));
+    EXPECT_GT(stats.root_finding_seconds, 0);
+    options.extract_roots = false;
+    options.distinct_degree = true;
+    EXPECT_TRUE(check_answer(expected, berlekamp_factor(poly, modp, options)));
+    EXPECT_GT(stats.distinct_degree_seconds, 0);
+}
+
+TEST(Trace, silent_by_default) {
+    std::vector<std::string> messages;
+    Trace::set_sink([&](TraceLevel, const char* stage, const std::string& message) {
+        messages.push_back(std::string(stage) + ": " + message);
+    });
+    ll modp = 5;
+    Polynomial poly("x^4+2x^2+x+1", modp);
+    berlekamp_factor(poly, modp);
+    EXPECT_TRUE(messages.empty());
+
+    Trace::set_level(TraceLevel::Info);
+    berlekamp_factor(poly, modp);
+    Trace::set_level(TraceLevel::Off);
+    Trace::set_sink(TraceSink());
+#ifndef BERLEKAMP_DISABLE_TRACE
+    EXPECT_FALSE(messages.empty());
+#endif
+}
+
+TEST(Matrix, parallel_row_echelon_form) {
+    std::mt19937_64 rng(10);
+    ThreadPool pool(3);
+    for (ll modp : {65537LL, 2305843009213693951LL}) {
+        int n = 300;
+        Matrix m(n, modp);
+        for (int i = 0; i < n; i++) {
+            for (int j = 0; j < n; j++) {
+                m.set(i, j, i % 4 == 3 ? m.get(i - 2, j) : (ll) (rng() % modp));
+            }
+        }
+        Matrix parallel = m;
+        m.row_echelon_form();
+        parallel.row_echelon_form(&pool);
+        for (int i = 0; i < n; i++) {
+            for (int j = 0; j < n; j++) {
+                ASSERT_EQ(m.get(i, j), parallel.get(i, j));
+            }
+        }
+    }
+}
+
+TEST(Generators, factor_benchmark_inputs) {
+    // The inputs of BM_Factor: every prime, degree and input kind with the benchmark seed
+    const std::uint64_t seed = 20240501;
+    for (ll modp : Generators::primes()) {
+        for (int degree : {16, 64, 256, 1024}) {
+            for (const auto& poly : {Generators::random(degree, modp, seed),
+                                     Generators::irreducible_product(degree, modp, seed),
+                                     Generators::sparse(degree, modp, seed),
+                                     Generators::repeated_factors(degree, modp, seed)}) {
+                EXPECT_EQ(degree, poly.get_degree()) << "p=" << modp;
+                EXPECT_EQ(modp, poly.get_modp());
+                EXPECT_EQ(1, poly.get_coeffs(degree + 1)[degree]);
+            }
+        }
+    }
+}